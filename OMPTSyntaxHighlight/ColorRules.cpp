@@ -0,0 +1,252 @@
+#include "ColorRules.hpp"
+#include "Highlighter.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+constexpr std::array<std::string_view, 5> RULE_FORMATS = { "MOD", "XM", "S3M", "IT", "MPT" };
+constexpr std::array<std::string_view, ColorRules::COLUMN_COUNT> RULE_COLUMNS = { "separator", "note", "instrument", "volume", "effect" };
+constexpr char RULE_CACHE_MAGIC[8] = { 'O', 'M', 'P', 'T', 'R', 'U', 'L', '2' };
+constexpr uint8_t UNDEFINED_SLOT = 0xFF;
+
+static size_t GetFormatIndex(std::string_view Format)
+{
+	// Formats are given as they appear in the clipboard header (" XM", " IT")
+	while (!Format.empty() && Format.front() == ' ') Format.remove_prefix(1);
+
+	const auto Found = std::ranges::find(RULE_FORMATS, Format);
+	if (Found == RULE_FORMATS.end())
+		throw std::invalid_argument("Unknown module format '" + std::string(Format) + "'");
+	return static_cast<size_t>(Found - RULE_FORMATS.begin());
+}
+
+static int ParseRuleNumber(const std::string& Text, const int Max)
+{
+	if (Text.empty() || Text.size() > 3 || Text.find_first_not_of("0123456789") != std::string::npos || std::stoi(Text) > Max)
+		throw std::invalid_argument("'" + Text + "' is not a number from 0 to " + std::to_string(Max));
+	return std::stoi(Text);
+}
+
+ColorRules::ColorRules()
+{
+	for (size_t Format = 0; Format < FORMAT_COUNT; Format++)
+	{
+		// GetEffectCmdColor expects the format as written in the clipboard header
+		const std::string_view HeaderFormat = (Format == 1) ? " XM" : (Format == 3) ? " IT" : RULE_FORMATS[Format];
+
+		for (int c = 0; c < 256; c++)
+		{
+			const char Char = static_cast<char>(c);
+			Slots[Format][SEPARATOR][c] = 7;
+			Slots[Format][NOTE][c] = static_cast<uint8_t>(GetNoteColor(Char));
+			Slots[Format][INSTRUMENT][c] = static_cast<uint8_t>(GetInstrumentColor(Char));
+			Slots[Format][VOLUME][c] = static_cast<uint8_t>(GetVolumeCmdColor(Char));
+			Slots[Format][EFFECT][c] = static_cast<uint8_t>(GetEffectCmdColor(Char, HeaderFormat));
+		}
+	}
+}
+
+ColorRules ColorRules::Load(const std::string& Path)
+{
+	std::error_code Error;
+	const uint64_t SourceSize = std::filesystem::file_size(Path, Error);
+	if (Error)
+		throw std::runtime_error("Cannot read rule file '" + Path + "'");
+	const int64_t SourceTime = std::filesystem::last_write_time(Path, Error).time_since_epoch().count();
+
+	// The cache holds the built-in rules as well, so it is only valid for the binary that compiled the same ones
+	ColorRules Rules;
+	const uint64_t BuiltInHash = Rules.GetHash();
+	const std::string CachePath = Path + ".cache";
+	if (Rules.ReadCache(CachePath, SourceSize, SourceTime, BuiltInHash))
+		return Rules;
+
+	std::ifstream File(Path, std::ios::binary);
+	if (!File)
+		throw std::runtime_error("Cannot read rule file '" + Path + "'");
+	std::ostringstream Text;
+	Text << File.rdbuf();
+
+	Rules.Parse(Text.str());
+
+	// A missing or read-only cache only costs the parsing next time
+	Rules.WriteCache(CachePath, SourceSize, SourceTime, BuiltInHash);
+	return Rules;
+}
+
+void ColorRules::Parse(const std::string_view Text)
+{
+	std::istringstream Lines{ std::string(Text) };
+	std::string Line;
+	for (int LineNumber = 1; std::getline(Lines, Line); LineNumber++)
+	{
+		std::istringstream Tokens(Line);
+		std::vector<std::string> Words;
+		for (std::string Word; Tokens >> Word;) Words.push_back(Word);
+		if (Words.empty() || Words[0][0] == '#') continue;
+
+		try
+		{
+			if (Words[0] == "slot")
+			{
+				if (Words.size() != 3)
+					throw std::invalid_argument("expected 'slot NUMBER COLOR'");
+
+				const int Slot = ParseRuleNumber(Words[1], UNDEFINED_SLOT - 1);
+				if (Slot < 8)
+					throw std::invalid_argument("slots 0 to 7 are the colors given on the command line");
+
+				if (Palette.size() < static_cast<size_t>(Slot - 7)) Palette.resize(Slot - 7, UNDEFINED_SLOT);
+				Palette[Slot - 8] = static_cast<uint8_t>(ParseRuleNumber(Words[2], 15));
+				continue;
+			}
+
+			if (Words.size() != 4)
+				throw std::invalid_argument("expected 'FORMATS COLUMN CHARACTERS SLOT'");
+
+			std::vector<size_t> Formats;
+			if (Words[0] == "*")
+			{
+				for (size_t Format = 0; Format < FORMAT_COUNT; Format++) Formats.push_back(Format);
+			}
+			else
+			{
+				std::istringstream Names(Words[0]);
+				for (std::string Format; std::getline(Names, Format, ',');)
+					Formats.push_back(GetFormatIndex(Format));
+			}
+
+			const auto ColumnName = std::ranges::find(RULE_COLUMNS, Words[1]);
+			if (ColumnName == RULE_COLUMNS.end())
+				throw std::invalid_argument("unknown column '" + Words[1] + "'");
+
+			const int Slot = ParseRuleNumber(Words[3], UNDEFINED_SLOT - 1);
+			if (Slot >= 8 && (static_cast<size_t>(Slot - 8) >= Palette.size() || Palette[Slot - 8] == UNDEFINED_SLOT))
+				throw std::invalid_argument("slot " + std::to_string(Slot) + " is not defined");
+
+			for (const size_t Format : Formats)
+			{
+				for (const char c : Words[2])
+					Slots[Format][ColumnName - RULE_COLUMNS.begin()][static_cast<uint8_t>(c)] = static_cast<uint8_t>(Slot);
+			}
+		}
+		catch (const std::invalid_argument& e)
+		{
+			throw std::runtime_error("Rule file line " + std::to_string(LineNumber) + ": " + e.what());
+		}
+	}
+}
+
+// FNV-1a over the slot tables
+uint64_t ColorRules::GetHash() const
+{
+	uint64_t Hash = 0xCBF29CE484222325u;
+	for (const SlotTable& Format : Slots)
+	{
+		for (const auto& Characters : Format)
+		{
+			for (const uint8_t Slot : Characters)
+				Hash = (Hash ^ Slot) * 0x100000001B3u;
+		}
+	}
+	return Hash;
+}
+
+bool ColorRules::ReadCache(const std::string& Path, const uint64_t SourceSize, const int64_t SourceTime, const uint64_t BuiltInHash)
+{
+	std::ifstream File(Path, std::ios::binary);
+	if (!File) return false;
+
+	char Magic[sizeof(RULE_CACHE_MAGIC)] = {};
+	uint64_t CachedSize = 0;
+	int64_t CachedTime = 0;
+	uint64_t CachedBuiltInHash = 0;
+	uint64_t PaletteSize = 0;
+	File.read(Magic, sizeof(Magic));
+	File.read(reinterpret_cast<char*>(&CachedSize), sizeof(CachedSize));
+	File.read(reinterpret_cast<char*>(&CachedTime), sizeof(CachedTime));
+	File.read(reinterpret_cast<char*>(&CachedBuiltInHash), sizeof(CachedBuiltInHash));
+	File.read(reinterpret_cast<char*>(&PaletteSize), sizeof(PaletteSize));
+
+	if (!File || !std::equal(std::begin(Magic), std::end(Magic), std::begin(RULE_CACHE_MAGIC)) ||
+		CachedSize != SourceSize || CachedTime != SourceTime || CachedBuiltInHash != BuiltInHash || PaletteSize >= UNDEFINED_SLOT)
+		return false;
+
+	std::vector<uint8_t> CachedPalette(PaletteSize);
+	std::array<SlotTable, FORMAT_COUNT> CachedSlots;
+	File.read(reinterpret_cast<char*>(CachedPalette.data()), static_cast<std::streamsize>(CachedPalette.size()));
+	File.read(reinterpret_cast<char*>(CachedSlots.data()), sizeof(CachedSlots));
+	if (!File) return false;
+
+	// A damaged cache is parsed again instead of trusted: every palette color is one of the 16 or undefined, and every
+	// slot is a command line color or a defined palette one
+	if (std::ranges::any_of(CachedPalette, [](const uint8_t Color) { return Color > 15 && Color != UNDEFINED_SLOT; }))
+		return false;
+	for (const SlotTable& Format : CachedSlots)
+	{
+		for (const auto& Characters : Format)
+		{
+			for (const uint8_t Slot : Characters)
+			{
+				if (Slot >= 8 && (Slot - 8u >= CachedPalette.size() || CachedPalette[Slot - 8] == UNDEFINED_SLOT))
+					return false;
+			}
+		}
+	}
+
+	Palette = std::move(CachedPalette);
+	Slots = CachedSlots;
+	return true;
+}
+
+void ColorRules::WriteCache(const std::string& Path, const uint64_t SourceSize, const int64_t SourceTime, const uint64_t BuiltInHash) const
+{
+	// Written next to the final file and renamed, so a concurrent reader never sees half of it
+	const std::string TemporaryPath = Path + ".tmp";
+	bool Written = false;
+	{
+		std::ofstream File(TemporaryPath, std::ios::binary | std::ios::trunc);
+		if (!File) return;
+
+		const uint64_t PaletteSize = Palette.size();
+		File.write(RULE_CACHE_MAGIC, sizeof(RULE_CACHE_MAGIC));
+		File.write(reinterpret_cast<const char*>(&SourceSize), sizeof(SourceSize));
+		File.write(reinterpret_cast<const char*>(&SourceTime), sizeof(SourceTime));
+		File.write(reinterpret_cast<const char*>(&BuiltInHash), sizeof(BuiltInHash));
+		File.write(reinterpret_cast<const char*>(&PaletteSize), sizeof(PaletteSize));
+		File.write(reinterpret_cast<const char*>(Palette.data()), static_cast<std::streamsize>(Palette.size()));
+		File.write(reinterpret_cast<const char*>(Slots.data()), sizeof(Slots));
+		File.close();
+		Written = !File.fail();
+	}
+
+	std::error_code Error;
+	if (Written) std::filesystem::rename(TemporaryPath, Path, Error);
+	if (!Written || Error) std::filesystem::remove(TemporaryPath, Error);
+}
+
+const ColorRules::SlotTable& ColorRules::GetSlots(const std::string_view Format) const
+{
+	return Slots[GetFormatIndex(Format)];
+}
+
+int ColorRules::GetSlotColor(const size_t Slot, const std::array<int, 8>& Colors) const
+{
+	return (Slot < 8) ? Colors[Slot] : Palette.at(Slot - 8);
+}
+
+ColorTable::ColorTable(const ColorRules& rules, const std::array<int, 8>& colors, const std::string_view format)
+{
+	const ColorRules::SlotTable& Slots = rules.GetSlots(format);
+	for (size_t Column = 0; Column < ColorRules::COLUMN_COUNT; Column++)
+	{
+		for (size_t c = 0; c < 256; c++)
+			Colors[Column][c] = static_cast<uint8_t>(rules.GetSlotColor(Slots[Column][c], colors));
+	}
+
+	for (int Color = 0; Color < 16; Color++)
+		SGRCodes[Color] = ::GetSGRCode(Color);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Highlighting rules: for every module format and classified column of a cell, the palette slot of each character.
+// The built-in rules are the ones of GetNoteColor/GetInstrumentColor/GetVolumeCmdColor/GetEffectCmdColor.
+//
+// A rule file overrides them, one rule per line ('#' starts a comment line):
+//     slot 8 14                  palette slot 8 and up gets a color from 0 to 15 (0-7 are the command line colors)
+//     IT,S3M,MPT effect AT 8     FORMATS COLUMN CHARACTERS SLOT
+//     * volume v 2               '*' matches every format (MOD, XM, S3M, IT, MPT)
+// Columns are separator, note, instrument, volume and effect. Slots have to be defined before they are used.
+class ColorRules
+{
+public:
+	enum Column { SEPARATOR, NOTE, INSTRUMENT, VOLUME, EFFECT, COLUMN_COUNT };
+
+	using SlotTable = std::array<std::array<uint8_t, 256>, COLUMN_COUNT>;
+
+	ColorRules();
+
+	// Parses the rule file, or loads the compiled rules cached next to it ("<file>.cache") when they are up to date.
+	// Throws std::runtime_error if the file cannot be read or has an invalid rule.
+	static ColorRules Load(const std::string& Path);
+
+	const SlotTable& GetSlots(std::string_view Format) const;
+	int GetSlotColor(size_t Slot, const std::array<int, 8>& Colors) const;
+
+private:
+	static constexpr size_t FORMAT_COUNT = 5;
+
+	void Parse(std::string_view Text);
+	uint64_t GetHash() const;
+	bool ReadCache(const std::string& Path, uint64_t SourceSize, int64_t SourceTime, uint64_t BuiltInHash);
+	void WriteCache(const std::string& Path, uint64_t SourceSize, int64_t SourceTime, uint64_t BuiltInHash) const;
+
+	std::array<SlotTable, FORMAT_COUNT> Slots{};
+
+	// Colors of the slots after the first 8, 0xFF for the ones that are not defined
+	std::vector<uint8_t> Palette;
+};
+
+// The rules of one format with every slot resolved to its color, used by the highlighter for each byte
+struct ColorTable
+{
+	ColorTable(const ColorRules& rules, const std::array<int, 8>& colors, std::string_view format);
+
+	int Get(const ColorRules::Column Column, const char c) const { return Colors[Column][static_cast<uint8_t>(c)]; }
+	const std::string& GetSGRCode(const int Color) const { return SGRCodes[Color]; }
+
+	ColorRules::SlotTable Colors{};
+	std::array<std::string, 16> SGRCodes;
+};
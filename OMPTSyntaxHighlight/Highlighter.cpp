@@ -0,0 +1,422 @@
+#include "Highlighter.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+constexpr size_t CELL_TABLE_MIN_SIZE = 16;
+constexpr size_t CELL_TABLE_SIZE = 4096;
+constexpr size_t CELL_MAX_LENGTH = 256;
+
+// Standard 16-color terminal palette, used to translate SGR codes to HTML colors
+constexpr std::array<std::string_view, 16> HTML_COLORS = {
+	"#000000", "#cd3131", "#0dbc79", "#e5e510", "#2472c8", "#bc3fbc", "#11a8cd", "#e5e5e5",
+	"#666666", "#f14c4c", "#23d18b", "#f5f543", "#3b8eea", "#d670d6", "#29b8db", "#ffffff"
+};
+
+std::string Highlight(const std::string_view Input, const ColorTable& Table, PatternStats* Stats)
+{
+	std::string Output;
+	CellRenderer Renderer(Table);
+	Renderer.Render(Output, Input, Stats);
+	return Output;
+}
+
+CellRenderer::CellRenderer(const ColorTable& table)
+	: Colors(table)
+{
+}
+
+void CellRenderer::Render(std::string& Output, const std::string_view Input, PatternStats* stats)
+{
+	Output.reserve(Output.size() + Input.size() * 2);
+	Stats = stats;
+
+	// Start with a slot for every cell, a pattern has far fewer distinct ones
+	const size_t CellCount = static_cast<size_t>(std::ranges::count(Input, '|'));
+	const size_t Wanted = std::clamp(std::bit_ceil(CellCount), CELL_TABLE_MIN_SIZE, CELL_TABLE_SIZE);
+	if (Table.size() < Wanted) Grow(Wanted);
+
+	Channel = 0;
+	RowEmpty = true;
+
+	// Nothing before the first channel separator is ever colored
+	size_t Start = Input.find('|');
+	Output += Input.substr(0, Start);
+	int PreviousColor = -1;
+
+	while (Start < Input.size())
+	{
+		size_t End = Input.find('|', Start + 1);
+		if (End == std::string_view::npos) End = Input.size();
+		const std::string_view Cell = Input.substr(Start, End - Start);
+
+		// Count the identical cells that directly follow this one
+		size_t Run = 1;
+		while (End + Cell.size() <= Input.size() && Input.compare(End, Cell.size(), Cell) == 0 &&
+			(End + Cell.size() == Input.size() || Input[End + Cell.size()] == '|'))
+		{
+			End += Cell.size();
+			Run++;
+		}
+
+		PreviousColor = EmitCell(Output, Cell, PreviousColor, 1);
+
+		// Every repetition enters with the color the first one left, so they all render the same
+		if (Run > 1) PreviousColor = EmitCell(Output, Cell, PreviousColor, Run - 1);
+
+		Start = End;
+	}
+
+	// The last row may not end with a newline
+	if (Stats != nullptr && Channel > 0) CountRow();
+}
+
+int CellRenderer::EmitCell(std::string& Output, const std::string_view Cell, const int PreviousColor, const size_t Count)
+{
+	const Entry* Cached = Lookup(Cell, PreviousColor);
+	if (Cached == nullptr)
+	{
+		CellSummary Summary;
+		int Color = PreviousColor;
+		for (size_t i = 0; i < Count; i++)
+			Color = RenderCell(Output, Cell, PreviousColor, Summary);
+		if (Stats != nullptr) CountCell(Summary, Count);
+		return Color;
+	}
+
+	const std::string_view Rendered(Arena.data() + Cached->RenderedOffset, Cached->RenderedLength);
+	for (size_t i = 0; i < Count; i++)
+		Output += Rendered;
+	if (Stats != nullptr) CountCell(Cached->Summary, Count);
+	return Cached->OutColor;
+}
+
+const CellRenderer::Entry* CellRenderer::Lookup(const std::string_view Cell, const int PreviousColor)
+{
+	if (Cell.size() > CELL_MAX_LENGTH) return nullptr;
+
+	const size_t Hash = std::hash<std::string_view>{}(Cell) ^ (static_cast<size_t>(PreviousColor + 1) * 0x9E3779B97F4A7C15u);
+	const size_t Mask = Table.size() - 1;
+
+	for (size_t Slot = Hash & Mask;; Slot = (Slot + 1) & Mask)
+	{
+		Entry& Candidate = Table[Slot];
+		if (!Candidate.Used)
+		{
+			// The table is kept at most half full. Once it cannot grow any more, further cells are rendered directly.
+			if (UsedEntries >= Table.size() / 2)
+			{
+				if (Table.size() >= CELL_TABLE_SIZE) return nullptr;
+				Grow(Table.size() * 2);
+				return Lookup(Cell, PreviousColor);
+			}
+
+			Candidate.Used = true;
+			Candidate.Hash = Hash;
+			Candidate.InColor = static_cast<int8_t>(PreviousColor);
+			Candidate.KeyOffset = static_cast<uint32_t>(Arena.size());
+			Candidate.KeyLength = static_cast<uint16_t>(Cell.size());
+			Arena += Cell;
+
+			std::string Rendered;
+			Candidate.OutColor = static_cast<int8_t>(RenderCell(Rendered, Cell, PreviousColor, Candidate.Summary));
+			Candidate.RenderedOffset = static_cast<uint32_t>(Arena.size());
+			Candidate.RenderedLength = static_cast<uint16_t>(Rendered.size());
+			Arena += Rendered;
+
+			UsedEntries++;
+			return &Candidate;
+		}
+
+		if (Candidate.Hash == Hash && Candidate.InColor == PreviousColor &&
+			std::string_view(Arena.data() + Candidate.KeyOffset, Candidate.KeyLength) == Cell)
+			return &Candidate;
+	}
+}
+
+void CellRenderer::Grow(const size_t Size)
+{
+	// Entries keep their hash, so they are moved over without looking at their cells again
+	const std::vector<Entry> Old = std::exchange(Table, std::vector<Entry>(Size));
+	const size_t Mask = Size - 1;
+	for (const Entry& Moved : Old)
+	{
+		if (!Moved.Used) continue;
+		size_t Slot = Moved.Hash & Mask;
+		while (Table[Slot].Used) Slot = (Slot + 1) & Mask;
+		Table[Slot] = Moved;
+	}
+}
+
+int CellRenderer::RenderCell(std::string& Output, const std::string_view Cell, int PreviousColor, CellSummary& Summary) const
+{
+	int Color = -1;
+	Summary = CellSummary();
+
+	for (int RelPos = 0; RelPos < Cell.length(); RelPos++)
+	{
+		char c = Cell[RelPos];
+
+		if (RelPos == 0) Color = Colors.Get(ColorRules::SEPARATOR, c);
+		if (RelPos == 1)
+		{
+			Color = Colors.Get(ColorRules::NOTE, c);
+			Summary.Note = GetNoteColor(c) != 0;
+		}
+		if (RelPos == 4)
+		{
+			Color = Colors.Get(ColorRules::INSTRUMENT, c);
+			if (GetInstrumentColor(c) != 0 && RelPos + 1 < Cell.length() && std::isdigit(static_cast<uint8_t>(c)) &&
+				std::isdigit(static_cast<uint8_t>(Cell[RelPos + 1])))
+				Summary.Instrument = static_cast<int8_t>((c - '0') * 10 + (Cell[RelPos + 1] - '0'));
+		}
+		if (RelPos == 6) Color = Colors.Get(ColorRules::VOLUME, c);
+
+		if (RelPos >= 9)
+		{
+			if (RelPos % 3 == 0)
+			{
+				Color = Colors.Get(ColorRules::EFFECT, c);
+				if (c != '.' && !isWhitespace(c) && Summary.EffectCount < Summary.Effects.size())
+					Summary.Effects[Summary.EffectCount++] = c;
+			}
+			if (RelPos % 3 != 0 && c == '.' && Cell[RelPos - (RelPos % 3)] != '.') c = '0';
+		}
+
+		if (RelPos > 0 && c != '.' && !isWhitespace(c)) Summary.Empty = false;
+		if (c == '\n') Summary.EndsRow = true;
+
+		if (!isWhitespace(c))
+		{
+			if (Color != PreviousColor) Output += Colors.GetSGRCode(Color);
+			PreviousColor = Color;
+		}
+
+		Output += c;
+	}
+
+	return PreviousColor;
+}
+
+void CellRenderer::CountCell(const CellSummary& Summary, const size_t Count)
+{
+	for (size_t i = 0; i < Count; i++)
+	{
+		if (Summary.Note)
+		{
+			if (Stats->NotesPerChannel.size() <= Channel) Stats->NotesPerChannel.resize(Channel + 1);
+			Stats->NotesPerChannel[Channel]++;
+		}
+		if (Summary.Instrument >= 0) Stats->Instruments[Summary.Instrument]++;
+		for (size_t Effect = 0; Effect < Summary.EffectCount; Effect++)
+			Stats->EffectCommands[static_cast<uint8_t>(Summary.Effects[Effect])]++;
+
+		RowEmpty = RowEmpty && Summary.Empty;
+		Channel++;
+		if (Summary.EndsRow) CountRow();
+	}
+}
+
+void CellRenderer::CountRow()
+{
+	if (Stats->NotesPerChannel.size() < Channel) Stats->NotesPerChannel.resize(Channel);
+	Stats->Rows++;
+	if (RowEmpty) Stats->EmptyRows++;
+	Channel = 0;
+	RowEmpty = true;
+}
+
+std::string WrapMarkdown(const std::string_view Ansi)
+{
+	std::string Output = "```ansi\n";
+	Output += Ansi;
+	Output += "```";
+	return Output;
+}
+
+// Keeps the header line and only the selected (0-based) rows and (1-based) channels of pattern text.
+// Rows and cells are found with memchr on the newlines and '|' separators, skipped ones are never looked at byte by byte.
+std::string ProjectPattern(const std::string_view Input, const RangeList& Rows, const RangeList& Channels)
+{
+	const char* const Begin = Input.data();
+	const char* const End = Begin + Input.size();
+	const int LastRow = Rows.GetLast();
+	const int LastChannel = Channels.GetLast();
+
+	auto FindOrEnd = [](const char* From, const char* To, const char c)
+	{
+		const void* Found = std::memchr(From, c, To - From);
+		return Found != nullptr ? static_cast<const char*>(Found) : To;
+	};
+
+	std::string Output;
+	Output.reserve(Input.size());
+
+	const char* Line = FindOrEnd(Begin, End, '\n');
+	if (Line != End) Line++;
+	Output.append(Begin, Line);
+
+	for (int Row = 0; Line < End && Row <= LastRow; Row++)
+	{
+		const char* LineEnd = FindOrEnd(Line, End, '\n');
+		const char* Next = (LineEnd != End) ? LineEnd + 1 : End;
+
+		if (!Rows.Contains(Row))
+		{
+			Line = Next;
+			continue;
+		}
+
+		if (Channels.IsEmpty())
+		{
+			Output.append(Line, Next);
+			Line = Next;
+			continue;
+		}
+
+		// The line ending (\n or \r\n) is kept even when the last channel is dropped
+		const char* ContentEnd = (LineEnd != Line && LineEnd[-1] == '\r') ? LineEnd - 1 : LineEnd;
+		const char* Cell = FindOrEnd(Line, ContentEnd, '|');
+		Output.append(Line, Cell);
+
+		for (int Channel = 1; Cell < ContentEnd && Channel <= LastChannel; Channel++)
+		{
+			const char* CellEnd = FindOrEnd(Cell + 1, ContentEnd, '|');
+			if (Channels.Contains(Channel)) Output.append(Cell, CellEnd);
+			Cell = CellEnd;
+		}
+
+		Output.append(ContentEnd, Next);
+		Line = Next;
+	}
+
+	return Output;
+}
+
+std::string AnsiToHtml(const std::string_view Ansi)
+{
+	std::string Output = "<pre style=\"font-family:monospace\">";
+	bool SpanOpen = false;
+
+	for (size_t i = 0; i < Ansi.length(); i++)
+	{
+		const char c = Ansi[i];
+		if (c == '\u001B' && i + 1 < Ansi.length() && Ansi[i + 1] == '[')
+		{
+			// Only the codes written by GetSGRCode are expected here (30-37 and 90-97)
+			const size_t End = Ansi.find('m', i);
+			if (End == std::string_view::npos) break;
+
+			int Code = 0;
+			for (size_t j = i + 2; j < End; j++)
+			{
+				if (Ansi[j] >= '0' && Ansi[j] <= '9') Code = Code * 10 + (Ansi[j] - '0');
+			}
+
+			int Color = -1;
+			if (Code >= 30 && Code <= 37) Color = Code - 30;
+			else if (Code >= 90 && Code <= 97) Color = Code - 82;
+
+			if (SpanOpen) Output += "</span>";
+			SpanOpen = Color >= 0;
+			if (SpanOpen)
+			{
+				Output += "<span style=\"color:";
+				Output += HTML_COLORS[Color];
+				Output += "\">";
+			}
+
+			i = End;
+			continue;
+		}
+
+		switch (c)
+		{
+			case '&': Output += "&amp;"; break;
+			case '<': Output += "&lt;"; break;
+			case '>': Output += "&gt;"; break;
+			default: Output += c; break;
+		}
+	}
+
+	if (SpanOpen) Output += "</span>";
+	Output += "</pre>";
+	return Output;
+}
+
+PatternRenderer::PatternRenderer(std::string input, const ColorTable& table)
+	: Input(std::move(input)), Colors(table)
+{
+}
+
+const std::string& PatternRenderer::Ansi(PatternStats* Stats)
+{
+	if (!AnsiCache.has_value())
+		AnsiCache = Highlight(Input, Colors, Stats);
+	return AnsiCache.value();
+}
+
+bool isWhitespace(const char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+std::string GetSGRCode(const int color)
+{
+	return "\u001B[" + std::to_string(color + ((color < 8) ? 30 : 82)) + "m";
+}
+
+int GetNoteColor(const char c)
+{
+	return (c >= 'A' && c <= 'G') ? 1 : 0;
+}
+
+int GetInstrumentColor(const char c)
+{
+	return c >= '0' ? 2 : 0;
+}
+
+int GetVolumeCmdColor(const char c)
+{
+	int color = 0;
+
+	switch (c)
+	{
+		case 'a': case 'b': case 'c': case 'd': case 'v': color = 3; break;
+		case 'l': case 'p': case 'r': color = 4; break;
+		case 'e': case 'f': case 'g': case 'h': case 'u': color = 5; break;
+	}
+
+	return color;
+}
+
+int GetEffectCmdColor(const char c, const std::string_view f)
+{
+	int color = 0;
+	if (std::ranges::find(FORMATS_S, f) != FORMATS_S.end())
+	{
+		switch (c)
+		{
+			case 'D': case 'K': case 'L': case 'M': case 'N': case 'R': color = 3; break;
+			case 'P': case 'X': case 'Y': color = 4; break;
+			case 'E': case 'F': case 'G': case 'H': case 'U': case '+': case '*': color = 5; break;
+			case 'A': case 'B': case 'C': case 'T': case 'V': case 'W': color = 6; break;
+		}
+	}
+	else if (std::ranges::find(FORMATS_M, f) != FORMATS_M.end())
+	{
+		switch (c)
+		{
+			case '5': case '6': case '7': case 'A': case 'C': color = 3; break;
+			case '8': case 'P': case 'Y': color = 4; break;
+			case '1': case '2': case '3': case '4': case 'X': color = 5; break;
+			case 'B': case 'D': case 'F': case 'G': case 'H': color = 6; break;
+		}
+	}
+
+	return color;
+}
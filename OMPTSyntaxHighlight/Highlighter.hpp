@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ColorRules.hpp"
+#include "PatternStats.hpp"
+#include "RangeList.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr std::string_view HEADER = "ModPlug Tracker ";
+constexpr std::array<std::string_view, 2> FORMATS_M = { "MOD", " XM" };
+constexpr std::array<std::string_view, 3>  FORMATS_S = { "S3M", " IT", "MPT" };
+
+// Clipboard targets offered next to the plain text ones when copying
+constexpr const char* TARGET_PLAIN = "text/x-modplug-pattern";
+constexpr const char* TARGET_ANSI = "text/x-ansi";
+constexpr const char* TARGET_MARKDOWN = "text/x-ansi-markdown";
+constexpr const char* TARGET_HTML = "text/html";
+
+std::string Highlight(std::string_view Input, const ColorTable& Table, PatternStats* Stats = nullptr);
+std::string WrapMarkdown(std::string_view Ansi);
+std::string ProjectPattern(std::string_view Input, const RangeList& Rows, const RangeList& Channels);
+std::string AnsiToHtml(std::string_view Ansi);
+std::string GetSGRCode(int color);
+int GetEffectCmdColor(char c, std::string_view f);
+int GetVolumeCmdColor(char c);
+int GetInstrumentColor(char c);
+int GetNoteColor(char c);
+bool isWhitespace(char c);
+
+// Highlights pattern text one '|'-delimited channel cell at a time.
+// A cell renders the same whenever its bytes and the color in effect before it are the same, so rendered cells are
+// memoized in an open-addressing table and runs of identical cells (mostly empty ones) are emitted as copies.
+// The table is sized from the number of cells rendered and grows with them, so short patterns only pay for a few
+// entries. The color table is referenced, not copied, and has to outlive the renderer.
+class CellRenderer
+{
+public:
+	explicit CellRenderer(const ColorTable& table);
+
+	// Also counts the pattern statistics into Stats, if given, from the same cells
+	void Render(std::string& Output, std::string_view Input, PatternStats* Stats = nullptr);
+
+private:
+	// What the statistics need to know about a cell, classified once along with its rendering
+	struct CellSummary
+	{
+		bool Note = false;
+		bool Empty = true;
+		bool EndsRow = false;
+		int8_t Instrument = -1;
+		uint8_t EffectCount = 0;
+		std::array<char, 4> Effects{};
+	};
+
+	// Kept to 32 bytes, cells are at most CELL_MAX_LENGTH bytes long and colors fit in a byte
+	struct Entry
+	{
+		size_t Hash = 0;
+		uint32_t KeyOffset = 0;
+		uint32_t RenderedOffset = 0;
+		uint16_t KeyLength = 0;
+		uint16_t RenderedLength = 0;
+		int8_t InColor = -1;
+		int8_t OutColor = -1;
+		bool Used = false;
+		CellSummary Summary;
+	};
+
+	int EmitCell(std::string& Output, std::string_view Cell, int PreviousColor, size_t Count);
+	const Entry* Lookup(std::string_view Cell, int PreviousColor);
+	void Grow(size_t Size);
+	int RenderCell(std::string& Output, std::string_view Cell, int PreviousColor, CellSummary& Summary) const;
+	void CountCell(const CellSummary& Summary, size_t Count);
+	void CountRow();
+
+	const ColorTable& Colors;
+	std::vector<Entry> Table;
+	size_t UsedEntries = 0;
+	std::string Arena;
+
+	PatternStats* Stats = nullptr;
+	size_t Channel = 0;
+	bool RowEmpty = true;
+};
+
+// Renders the representations of one (already stripped) pattern on demand.
+// The ANSI rendering is memoized since the Markdown and HTML ones are built on top of it.
+class PatternRenderer
+{
+public:
+	PatternRenderer(std::string input, const ColorTable& table);
+
+	const std::string& Plain() const { return Input; }
+	// Statistics are only counted by the call that actually renders
+	const std::string& Ansi(PatternStats* Stats = nullptr);
+	std::string Markdown() { return WrapMarkdown(Ansi()); }
+	std::string Html() { return AnsiToHtml(Ansi()); }
+
+private:
+	const std::string Input;
+	const ColorTable Colors;
+	std::optional<std::string> AnsiCache;
+};
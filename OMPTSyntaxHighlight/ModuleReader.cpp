@@ -0,0 +1,616 @@
+#include "ModuleReader.hpp"
+#include "Highlighter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32) || defined(WIN32)
+	// std::min/std::max are used below, keep windows.h from defining them as macros
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+constexpr uint8_t NOTE_NONE = 0;
+constexpr uint8_t NOTE_MAX = 120;
+constexpr uint8_t NOTE_FADE = 253;
+constexpr uint8_t NOTE_CUT = 254;
+constexpr uint8_t NOTE_KEYOFF = 255;
+constexpr uint8_t ORDER_SEPARATOR = 254;
+constexpr uint8_t ORDER_END = 255;
+constexpr size_t MOD_HEADER_SIZE = 1084;
+constexpr size_t MAX_CHANNELS = 64;
+constexpr std::string_view NOTE_NAMES = "C-C#D-D#E-F-F#G-G#A-A#B-";
+constexpr std::string_view HEX_DIGITS = "0123456789ABCDEF";
+
+char GetEffectChar(uint8_t Effect);
+
+ModuleFile::ModuleFile(const std::string& path)
+{
+#if defined(_WIN32) || defined(WIN32)
+	const HANDLE File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Cannot open module file '" + path + "'");
+
+	LARGE_INTEGER FileSize{};
+	GetFileSizeEx(File, &FileSize);
+	Size = static_cast<size_t>(FileSize.QuadPart);
+	Mapping = Size > 0 ? CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(File);
+	if (Mapping != nullptr)
+		Data = static_cast<const uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	const int File = open(path.c_str(), O_RDONLY);
+	if (File < 0)
+		throw std::runtime_error("Cannot open module file '" + path + "'");
+
+	struct stat Stat{};
+	fstat(File, &Stat);
+	Size = static_cast<size_t>(Stat.st_size);
+	void* View = Size > 0 ? mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0) : MAP_FAILED;
+	close(File);
+	if (View != MAP_FAILED)
+	{
+		Data = static_cast<const uint8_t*>(View);
+		madvise(View, Size, MADV_WILLNEED);
+	}
+#endif
+
+	if (Data == nullptr)
+		throw std::runtime_error("Cannot map module file '" + path + "'");
+
+	// Identify the format by its signature; the destructor does not run if the constructor throws
+	try
+	{
+		if (Size >= 4 && std::memcmp(Data, "IMPM", 4) == 0) ReadIT();
+		else if (Size >= 0x30 && std::memcmp(Data + 0x2C, "SCRM", 4) == 0) ReadS3M();
+		else if (Size >= 17 && std::memcmp(Data, "Extended Module: ", 17) == 0) ReadXM();
+		else ReadMOD();
+	}
+	catch (...)
+	{
+		Unmap();
+		throw;
+	}
+}
+
+ModuleFile::~ModuleFile()
+{
+	Unmap();
+}
+
+void ModuleFile::Unmap()
+{
+#if defined(_WIN32) || defined(WIN32)
+	if (Data != nullptr) UnmapViewOfFile(Data);
+	if (Mapping != nullptr) CloseHandle(Mapping);
+	Mapping = nullptr;
+#else
+	if (Data != nullptr) munmap(const_cast<uint8_t*>(Data), Size);
+#endif
+	Data = nullptr;
+}
+
+uint8_t ModuleFile::Read8(const size_t Offset) const
+{
+	if (Offset >= Size)
+		throw std::runtime_error("Module file is truncated");
+	return Data[Offset];
+}
+
+uint16_t ModuleFile::Read16(const size_t Offset) const
+{
+	return static_cast<uint16_t>(Read8(Offset) | (Read8(Offset + 1) << 8));
+}
+
+uint32_t ModuleFile::Read32(const size_t Offset) const
+{
+	return static_cast<uint32_t>(Read16(Offset)) | (static_cast<uint32_t>(Read16(Offset + 2)) << 16);
+}
+
+void ModuleFile::ReadMOD()
+{
+	if (Size < MOD_HEADER_SIZE)
+		throw std::runtime_error("Unsupported module format");
+
+	const std::string_view Signature(reinterpret_cast<const char*>(Data) + 1080, 4);
+	if (Signature == "M.K." || Signature == "M!K!" || Signature == "FLT4" || Signature == "4CHN")
+		ChannelCount = 4;
+	else if (Signature == "FLT8" || Signature == "CD81" || Signature == "OKTA" || Signature == "OCTA")
+		ChannelCount = 8;
+	else if (Signature[0] >= '1' && Signature[0] <= '9' && Signature.substr(1) == "CHN")
+		ChannelCount = static_cast<size_t>(Signature[0] - '0');
+	else if (std::isdigit(static_cast<unsigned char>(Signature[0])) &&
+		std::isdigit(static_cast<unsigned char>(Signature[1])) && (Signature.substr(2) == "CH" || Signature.substr(2) == "CN"))
+		ChannelCount = static_cast<size_t>((Signature[0] - '0') * 10 + (Signature[1] - '0'));
+	else
+		throw std::runtime_error("Unsupported module format");
+
+	if (ChannelCount == 0 || ChannelCount > MAX_CHANNELS)
+		throw std::runtime_error("Unsupported channel count in MOD file");
+
+	ModuleType = Type::MOD;
+	Format = FORMATS_M[0];
+
+	// Every entry of the order list counts towards the pattern count, even past the song length
+	const size_t SongLength = std::min<size_t>(Read8(950), 128);
+	size_t PatternCount = 0;
+	for (size_t i = 0; i < 128; i++)
+	{
+		const uint8_t Order = Read8(952 + i);
+		if (i < SongLength) Orders.push_back(Order);
+		PatternCount = std::max<size_t>(PatternCount, Order + 1u);
+	}
+
+	const size_t PatternSize = 64 * ChannelCount * 4;
+	for (size_t i = 0; i < PatternCount; i++)
+		Patterns.push_back({ MOD_HEADER_SIZE + i * PatternSize, PatternSize, 64 });
+}
+
+void ModuleFile::ReadXM()
+{
+	ModuleType = Type::XM;
+	Format = FORMATS_M[1];
+
+	const size_t HeaderSize = Read32(60);
+	const size_t SongLength = std::min<size_t>(Read16(64), 256);
+	ChannelCount = Read16(68);
+	const size_t PatternCount = Read16(70);
+	if (ChannelCount == 0 || ChannelCount > MAX_CHANNELS)
+		throw std::runtime_error("Unsupported channel count in XM file");
+
+	for (size_t i = 0; i < SongLength; i++)
+		Orders.push_back(Read8(80 + i));
+
+	// Patterns are stored back to back, so only their headers are walked here
+	size_t Offset = 60 + HeaderSize;
+	for (size_t i = 0; i < PatternCount; i++)
+	{
+		const size_t PatternHeaderSize = Read32(Offset);
+		const size_t Rows = Read16(Offset + 5);
+		const size_t PackedSize = Read16(Offset + 7);
+		Patterns.push_back({ Offset + PatternHeaderSize, PackedSize, Rows });
+		Offset += PatternHeaderSize + PackedSize;
+	}
+}
+
+void ModuleFile::ReadS3M()
+{
+	ModuleType = Type::S3M;
+	Format = FORMATS_S[0];
+
+	const size_t OrderCount = Read16(0x20);
+	const size_t InstrumentCount = Read16(0x22);
+	const size_t PatternCount = Read16(0x24);
+
+	// Unused channels are 255, bit 7 only mutes a channel
+	for (size_t i = 0; i < 32; i++)
+	{
+		if ((Read8(0x40 + i) & 0x7F) < 32) ChannelCount = i + 1;
+	}
+
+	for (size_t i = 0; i < OrderCount; i++)
+		Orders.push_back(Read8(0x60 + i));
+
+	const size_t PointerTable = 0x60 + OrderCount + InstrumentCount * 2;
+	for (size_t i = 0; i < PatternCount; i++)
+	{
+		const size_t Offset = static_cast<size_t>(Read16(PointerTable + i * 2)) * 16;
+		if (Offset == 0)
+			Patterns.push_back({ 0, 0, 64 });
+		else
+			Patterns.push_back({ Offset + 2, Read16(Offset), 64 });
+	}
+}
+
+void ModuleFile::ReadIT()
+{
+	ModuleType = Type::IT;
+
+	// MPTM files share the IT layout and are told apart by their tracker version
+	const uint16_t TrackerVersion = Read16(0x28);
+	Format = ((TrackerVersion & 0xFFF0) == 0x0880) ? FORMATS_S[2] : FORMATS_S[1];
+
+	const size_t OrderCount = Read16(0x20);
+	const size_t InstrumentCount = Read16(0x22);
+	const size_t SampleCount = Read16(0x24);
+	const size_t PatternCount = Read16(0x26);
+
+	for (size_t i = 0; i < OrderCount; i++)
+		Orders.push_back(Read8(0xC0 + i));
+
+	const size_t PointerTable = 0xC0 + OrderCount + InstrumentCount * 4 + SampleCount * 4;
+	for (size_t i = 0; i < PatternCount; i++)
+	{
+		const size_t Offset = Read32(PointerTable + i * 4);
+		if (Offset == 0)
+			Patterns.push_back({ 0, 0, 64 });
+		else
+			Patterns.push_back({ Offset + 8, Read16(Offset), Read16(Offset + 2) });
+	}
+
+	// Trackers enable all 64 channels in the header and bit 7 of a channel's panning only mutes it, so like OpenMPT
+	// the channel count is taken from the highest channel any pattern stores data for (muted ones included)
+	for (const PatternInfo& Info : Patterns)
+	{
+		std::array<uint8_t, MAX_CHANNELS> LastMask{};
+		size_t Offset = Info.Offset;
+		const size_t End = Info.Offset + Info.Size;
+
+		for (size_t Row = 0; Row < Info.Rows && Offset < End;)
+		{
+			const uint8_t ChannelVariable = Read8(Offset++);
+			if (ChannelVariable == 0)
+			{
+				Row++;
+				continue;
+			}
+
+			const size_t Channel = (ChannelVariable - 1) & 0x3F;
+			if (ChannelVariable & 0x80) LastMask[Channel] = Read8(Offset++);
+			const uint8_t Mask = LastMask[Channel];
+			if (Mask != 0) ChannelCount = std::max(ChannelCount, Channel + 1);
+
+			// Skip the note, instrument, volume and effect command + parameter bytes
+			Offset += ((Mask & 0x01) ? 1 : 0) + ((Mask & 0x02) ? 1 : 0) + ((Mask & 0x04) ? 1 : 0) + ((Mask & 0x08) ? 2 : 0);
+		}
+	}
+	ChannelCount = std::max<size_t>(ChannelCount, 1);
+}
+
+std::vector<std::pair<size_t, size_t>> ModuleFile::GetOrderPatterns() const
+{
+	std::vector<std::pair<size_t, size_t>> Result;
+	for (size_t i = 0; i < Orders.size(); i++)
+	{
+		if (ModuleType == Type::S3M || ModuleType == Type::IT)
+		{
+			if (Orders[i] == ORDER_END) break;
+			if (Orders[i] == ORDER_SEPARATOR) continue;
+		}
+		if (Orders[i] < Patterns.size()) Result.emplace_back(i, Orders[i]);
+	}
+	return Result;
+}
+
+std::string ModuleFile::DecodePattern(const size_t Pattern, const RangeList& Rows, const RangeList& Channels) const
+{
+	const PatternInfo& Info = Patterns.at(Pattern);
+	std::vector<Cell> Cells(Info.Rows * ChannelCount);
+
+	if (Info.Size > 0)
+	{
+		switch (ModuleType)
+		{
+			case Type::MOD: DecodeMOD(Info, Cells); break;
+			case Type::XM: DecodeXM(Info, Cells); break;
+			case Type::S3M: DecodeS3M(Info, Cells); break;
+			case Type::IT: DecodeIT(Info, Cells); break;
+		}
+	}
+
+	std::vector<size_t> Selected;
+	for (size_t Channel = 0; Channel < ChannelCount; Channel++)
+	{
+		if (Channels.Contains(static_cast<int>(Channel) + 1)) Selected.push_back(Channel);
+	}
+
+	// Lines end in \r\n, as on OpenMPT's clipboard
+	std::string Text(HEADER);
+	Text += Format;
+	Text += "\r\n";
+	Text.reserve(Text.size() + Info.Rows * (Selected.size() * 12 + 2));
+
+	for (size_t Row = 0; Row < Info.Rows; Row++)
+	{
+		if (!Rows.Contains(static_cast<int>(Row))) continue;
+		for (const size_t Channel : Selected)
+			AppendCell(Text, Cells[Row * ChannelCount + Channel]);
+		Text += "\r\n";
+	}
+
+	return Text;
+}
+
+void ModuleFile::DecodeMOD(const PatternInfo& Info, std::vector<Cell>& Cells) const
+{
+	// Fixed size cells, so the bounds only need to be checked once
+	if (Info.Offset + Cells.size() * 4 > Size)
+		throw std::runtime_error("Module file is truncated");
+
+	for (size_t i = 0; i < Cells.size(); i++)
+	{
+		const uint8_t* Bytes = Data + Info.Offset + i * 4;
+		const uint8_t b0 = Bytes[0], b1 = Bytes[1], b2 = Bytes[2], b3 = Bytes[3];
+		Cell& cell = Cells[i];
+
+		// ProTracker C-1 (period 856) is shown as C-4 by OpenMPT
+		const int Period = ((b0 & 0x0F) << 8) | b1;
+		if (Period > 0)
+		{
+			const long Note = std::lround(12.0 * std::log2(856.0 / Period)) + 49;
+			cell.Note = static_cast<uint8_t>(std::clamp<long>(Note, 1, NOTE_MAX));
+		}
+
+		cell.Instrument = static_cast<uint8_t>((b0 & 0xF0) | (b2 >> 4));
+		if ((b2 & 0x0F) != 0 || b3 != 0)
+		{
+			cell.EffectCmd = GetEffectChar(b2 & 0x0F);
+			cell.Param = b3;
+		}
+	}
+}
+
+void ModuleFile::DecodeXM(const PatternInfo& Info, std::vector<Cell>& Cells) const
+{
+	size_t Offset = Info.Offset;
+	const size_t End = Info.Offset + Info.Size;
+
+	for (size_t i = 0; i < Cells.size() && Offset < End; i++)
+	{
+		// Either a flag byte telling which fields follow, or a note followed by all the other fields
+		const uint8_t First = Read8(Offset++);
+		uint8_t Flags = First & 0x80 ? First : 0x1E;
+		uint8_t Note = First & 0x80 ? 0 : First;
+		uint8_t Instrument = 0, Volume = 0, Effect = 0, Param = 0;
+
+		if (Flags & 0x01) Note = Read8(Offset++);
+		if (Flags & 0x02) Instrument = Read8(Offset++);
+		if (Flags & 0x04) Volume = Read8(Offset++);
+		if (Flags & 0x08) Effect = Read8(Offset++);
+		if (Flags & 0x10) Param = Read8(Offset++);
+
+		Cell& cell = Cells[i];
+		if (Note == 97) cell.Note = NOTE_KEYOFF;
+		else if (Note > 0 && Note < 97) cell.Note = static_cast<uint8_t>(Note + 12);
+		cell.Instrument = Instrument;
+
+		if (Volume >= 0x10 && Volume <= 0x50)
+		{
+			cell.VolumeCmd = 'v';
+			cell.Volume = static_cast<uint8_t>(Volume - 0x10);
+		}
+		else if (Volume >= 0x60)
+		{
+			constexpr std::string_view VOLUME_COMMANDS = "dcbauhplrg";
+			cell.VolumeCmd = VOLUME_COMMANDS[(Volume >> 4) - 6];
+			cell.Volume = static_cast<uint8_t>((Volume & 0x0F) * (cell.VolumeCmd == 'p' ? 4 : 1));
+		}
+
+		if (Effect != 0 || Param != 0)
+		{
+			cell.EffectCmd = GetEffectChar(Effect);
+			cell.Param = Param;
+		}
+	}
+}
+
+void ModuleFile::DecodeS3M(const PatternInfo& Info, std::vector<Cell>& Cells) const
+{
+	size_t Offset = Info.Offset;
+	const size_t End = Info.Offset + Info.Size;
+
+	for (size_t Row = 0; Row < Info.Rows && Offset < End; Row++)
+	{
+		while (true)
+		{
+			const uint8_t What = Read8(Offset++);
+			if (What == 0) break;
+
+			// Data of channels past the channel count is read but dropped
+			const size_t Channel = What & 0x1F;
+			Cell Dropped;
+			Cell& cell = Channel < ChannelCount ? Cells[Row * ChannelCount + Channel] : Dropped;
+
+			if (What & 0x20)
+			{
+				const uint8_t Note = Read8(Offset++);
+				if (Note == 254) cell.Note = NOTE_CUT;
+				else if (Note < 254) cell.Note = static_cast<uint8_t>((Note >> 4) * 12 + (Note & 0x0F) + 13);
+				cell.Instrument = Read8(Offset++);
+			}
+			if (What & 0x40)
+			{
+				const uint8_t Volume = Read8(Offset++);
+				if (Volume <= 64)
+				{
+					cell.VolumeCmd = 'v';
+					cell.Volume = Volume;
+				}
+			}
+			if (What & 0x80)
+			{
+				const uint8_t Command = Read8(Offset++);
+				cell.Param = Read8(Offset++);
+				if (Command >= 1 && Command <= 26) cell.EffectCmd = static_cast<char>('A' + Command - 1);
+			}
+		}
+	}
+}
+
+void ModuleFile::DecodeIT(const PatternInfo& Info, std::vector<Cell>& Cells) const
+{
+	size_t Offset = Info.Offset;
+	const size_t End = Info.Offset + Info.Size;
+
+	// Masks and values are remembered per channel for the "same as last time" bits
+	std::array<uint8_t, MAX_CHANNELS> LastMask{}, LastNote{}, LastInstrument{}, LastVolume{}, LastCommand{}, LastParam{};
+
+	for (size_t Row = 0; Row < Info.Rows && Offset < End; Row++)
+	{
+		while (true)
+		{
+			const uint8_t ChannelVariable = Read8(Offset++);
+			if (ChannelVariable == 0) break;
+
+			const size_t Channel = (ChannelVariable - 1) & 0x3F;
+			if (ChannelVariable & 0x80) LastMask[Channel] = Read8(Offset++);
+			const uint8_t Mask = LastMask[Channel];
+
+			if (Mask & 0x01) LastNote[Channel] = Read8(Offset++);
+			if (Mask & 0x02) LastInstrument[Channel] = Read8(Offset++);
+			if (Mask & 0x04) LastVolume[Channel] = Read8(Offset++);
+			if (Mask & 0x08)
+			{
+				LastCommand[Channel] = Read8(Offset++);
+				LastParam[Channel] = Read8(Offset++);
+			}
+
+			if (Channel >= ChannelCount) continue;
+			Cell& cell = Cells[Row * ChannelCount + Channel];
+
+			if (Mask & 0x11)
+			{
+				const uint8_t Note = LastNote[Channel];
+				if (Note < NOTE_MAX) cell.Note = static_cast<uint8_t>(Note + 1);
+				else if (Note == 255) cell.Note = NOTE_KEYOFF;
+				else if (Note == 254) cell.Note = NOTE_CUT;
+				else cell.Note = NOTE_FADE;
+			}
+			if (Mask & 0x22) cell.Instrument = LastInstrument[Channel];
+			if (Mask & 0x44)
+			{
+				struct VolumeRange { uint8_t First, Last; char Command; };
+				constexpr std::array<VolumeRange, 10> VOLUME_RANGES = { {
+					{ 0, 64, 'v' }, { 65, 74, 'a' }, { 75, 84, 'b' }, { 85, 94, 'c' }, { 95, 104, 'd' },
+					{ 105, 114, 'e' }, { 115, 124, 'f' }, { 128, 192, 'p' }, { 193, 202, 'g' }, { 203, 212, 'h' }
+				} };
+
+				const uint8_t Volume = LastVolume[Channel];
+				for (const auto& [First, Last, Command] : VOLUME_RANGES)
+				{
+					if (Volume < First || Volume > Last) continue;
+					cell.VolumeCmd = Command;
+					cell.Volume = static_cast<uint8_t>(Volume - First);
+					break;
+				}
+			}
+			if (Mask & 0x88)
+			{
+				const uint8_t Command = LastCommand[Channel];
+				cell.Param = LastParam[Channel];
+				if (Command >= 1 && Command <= 26) cell.EffectCmd = static_cast<char>('A' + Command - 1);
+			}
+		}
+	}
+}
+
+char GetEffectChar(const uint8_t Effect)
+{
+	if (Effect < 10) return static_cast<char>('0' + Effect);
+	if (Effect < 36) return static_cast<char>('A' + Effect - 10);
+	return '?';
+}
+
+void ModuleFile::AppendCell(std::string& Text, const Cell& Cell)
+{
+	Text += '|';
+
+	if (Cell.Note == NOTE_NONE) Text += "...";
+	else if (Cell.Note == NOTE_KEYOFF) Text += "===";
+	else if (Cell.Note == NOTE_CUT) Text += "^^^";
+	else if (Cell.Note == NOTE_FADE) Text += "~~~";
+	else
+	{
+		Text += NOTE_NAMES.substr(((Cell.Note - 1) % 12) * 2, 2);
+		Text += static_cast<char>('0' + (Cell.Note - 1) / 12);
+	}
+
+	if (Cell.Instrument == 0) Text += "..";
+	else
+	{
+		Text += static_cast<char>('0' + (Cell.Instrument / 10) % 10);
+		Text += static_cast<char>('0' + Cell.Instrument % 10);
+	}
+
+	if (Cell.VolumeCmd == 0) Text += "...";
+	else
+	{
+		Text += Cell.VolumeCmd;
+		Text += static_cast<char>('0' + (Cell.Volume / 10) % 10);
+		Text += static_cast<char>('0' + Cell.Volume % 10);
+	}
+
+	if (Cell.EffectCmd == 0) Text += "...";
+	else
+	{
+		Text += Cell.EffectCmd;
+		Text += HEX_DIGITS[Cell.Param >> 4];
+		Text += HEX_DIGITS[Cell.Param & 0x0F];
+	}
+}
+
+void StreamPatterns(const ModuleFile& Module, const std::vector<size_t>& Patterns, const RangeList& Rows,
+	const RangeList& Channels, const std::function<std::string(size_t, std::string)>& Render, const std::function<void(const std::string&)>& Write)
+{
+	std::vector<std::optional<std::string>> Results(Patterns.size());
+	std::exception_ptr Error;
+	std::mutex Lock;
+	std::condition_variable Ready;
+	std::atomic<size_t> Next = 0;
+
+	auto Worker = [&]
+	{
+		for (size_t i = Next++; i < Patterns.size(); i = Next++)
+		{
+			std::string Text;
+			std::exception_ptr WorkerError;
+			try
+			{
+				Text = Render(i, Module.DecodePattern(Patterns[i], Rows, Channels));
+			}
+			catch (...)
+			{
+				WorkerError = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> LockGuard(Lock);
+				if (WorkerError && !Error) Error = WorkerError;
+				Results[i] = std::move(Text);
+			}
+			Ready.notify_all();
+		}
+	};
+
+	const size_t ThreadCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(Patterns.size(), 1));
+	std::vector<std::jthread> Threads;
+	for (size_t i = 0; i < ThreadCount; i++)
+		Threads.emplace_back(Worker);
+
+	for (size_t i = 0; i < Patterns.size(); i++)
+	{
+		std::string Text;
+		{
+			std::unique_lock<std::mutex> LockGuard(Lock);
+			Ready.wait(LockGuard, [&] { return Results[i].has_value() || Error; });
+			if (Error)
+			{
+				Next = Patterns.size();
+				LockGuard.unlock();
+				Threads.clear();
+				std::rethrow_exception(Error);
+			}
+			Text = std::move(Results[i].value());
+			Results[i].reset();
+		}
+		Write(Text);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "RangeList.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A MOD, XM, S3M, IT or MPTM file, memory-mapped read-only.
+// Its patterns are decoded on demand into the same text OpenMPT puts on the clipboard ("ModPlug Tracker ..." header
+// followed by one "|note instr vol effect" cell per channel and row, lines ending in "\r\n"), so they can go through the
+// regular highlighter.
+// Throws std::runtime_error if the file cannot be mapped or is not a supported module.
+class ModuleFile
+{
+public:
+	explicit ModuleFile(const std::string& path);
+	~ModuleFile();
+
+	ModuleFile(const ModuleFile&) = delete;
+	ModuleFile& operator=(const ModuleFile&) = delete;
+
+	std::string_view GetFormat() const { return Format; }
+	size_t GetChannelCount() const { return ChannelCount; }
+	size_t GetPatternCount() const { return Patterns.size(); }
+
+	// (order, pattern) pairs of the order list, separator ("+++") and end ("---") orders are skipped
+	std::vector<std::pair<size_t, size_t>> GetOrderPatterns() const;
+
+	// Decodes one pattern as OpenMPT clipboard text, limited to the selected (0-based) rows and (1-based) channels.
+	// Safe to call from several threads at once.
+	std::string DecodePattern(size_t Pattern, const RangeList& Rows, const RangeList& Channels) const;
+
+private:
+	enum class Type { MOD, XM, S3M, IT };
+
+	struct PatternInfo
+	{
+		size_t Offset = 0;
+		size_t Size = 0;
+		size_t Rows = 64;
+	};
+
+	struct Cell
+	{
+		uint8_t Note = 0;
+		uint8_t Instrument = 0;
+		char VolumeCmd = 0;
+		uint8_t Volume = 0;
+		char EffectCmd = 0;
+		uint8_t Param = 0;
+	};
+
+	void Unmap();
+	static void AppendCell(std::string& Text, const Cell& Cell);
+
+	void ReadMOD();
+	void ReadXM();
+	void ReadS3M();
+	void ReadIT();
+
+	void DecodeMOD(const PatternInfo& Info, std::vector<Cell>& Cells) const;
+	void DecodeXM(const PatternInfo& Info, std::vector<Cell>& Cells) const;
+	void DecodeS3M(const PatternInfo& Info, std::vector<Cell>& Cells) const;
+	void DecodeIT(const PatternInfo& Info, std::vector<Cell>& Cells) const;
+
+	uint8_t Read8(size_t Offset) const;
+	uint16_t Read16(size_t Offset) const;
+	uint32_t Read32(size_t Offset) const;
+
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+#if defined(_WIN32) || defined(WIN32)
+	void* Mapping = nullptr;
+#endif
+
+	Type ModuleType = Type::MOD;
+	std::string_view Format;
+	size_t ChannelCount = 0;
+	std::vector<uint16_t> Orders;
+	std::vector<PatternInfo> Patterns;
+};
+
+// Decodes the selected patterns on all cores, transforms each one with Render (given its index in Patterns) on the
+// decoding thread and passes the results to Write in pattern order, each as soon as it and all the ones before it are done.
+void StreamPatterns(const ModuleFile& Module, const std::vector<size_t>& Patterns, const RangeList& Rows,
+	const RangeList& Channels, const std::function<std::string(size_t, std::string)>& Render, const std::function<void(const std::string&)>& Write);
@@ -0,0 +1,69 @@
+#include "PatternStats.hpp"
+#include "Highlighter.hpp"
+
+#include <algorithm>
+
+// Names of the palette slots GetEffectCmdColor puts effect commands in
+constexpr std::array<std::string_view, 7> EFFECT_CLASSES = { "other", "", "", "volume", "panning", "pitch", "global" };
+
+PatternStats::PatternStats(const std::string_view format, const int pattern)
+	: Format(format), Pattern(pattern)
+{
+}
+
+std::string PatternStats::ToJson() const
+{
+	std::string_view FormatName = Format;
+	while (!FormatName.empty() && FormatName.front() == ' ') FormatName.remove_prefix(1);
+	const bool SampleFamily = std::ranges::find(FORMATS_S, Format) != FORMATS_S.end();
+
+	std::string Json = "{";
+	if (Pattern >= 0) Json += "\"pattern\":" + std::to_string(Pattern) + ",";
+	Json += "\"format\":\"" + std::string(FormatName) + "\",";
+	Json += "\"rows\":" + std::to_string(Rows) + ",";
+	Json += "\"empty_rows\":" + std::to_string(EmptyRows) + ",";
+
+	Json += "\"notes_per_channel\":[";
+	for (size_t Channel = 0; Channel < NotesPerChannel.size(); Channel++)
+		Json += (Channel > 0 ? "," : "") + std::to_string(NotesPerChannel[Channel]);
+	Json += "],";
+
+	Json += "\"instruments\":{";
+	bool First = true;
+	for (size_t Instrument = 0; Instrument < Instruments.size(); Instrument++)
+	{
+		if (Instruments[Instrument] == 0) continue;
+		Json += (First ? "\"" : ",\"") + std::to_string(Instrument) + "\":" + std::to_string(Instruments[Instrument]);
+		First = false;
+	}
+	Json += "},";
+
+	// Commands are counted by character, their classes come from the same classification as the highlighting
+	std::array<uint64_t, EFFECT_CLASSES.size()> Classes{};
+	Json += "\"effects\":{\"family\":\"";
+	Json += SampleFamily ? "S3M/IT/MPT" : "MOD/XM";
+	Json += "\",\"commands\":{";
+	First = true;
+	for (size_t c = 0; c < EffectCommands.size(); c++)
+	{
+		if (EffectCommands[c] == 0) continue;
+		Classes[GetEffectCmdColor(static_cast<char>(c), Format)] += EffectCommands[c];
+
+		Json += First ? "\"" : ",\"";
+		if (c == '"' || c == '\\') Json += '\\';
+		Json += static_cast<char>(c);
+		Json += "\":" + std::to_string(EffectCommands[c]);
+		First = false;
+	}
+	Json += "},\"classes\":{";
+	First = true;
+	for (size_t Class = 0; Class < Classes.size(); Class++)
+	{
+		if (EFFECT_CLASSES[Class].empty()) continue;
+		Json += (First ? "\"" : ",\"") + std::string(EFFECT_CLASSES[Class]) + "\":" + std::to_string(Classes[Class]);
+		First = false;
+	}
+	Json += "}}}";
+
+	return Json;
+}
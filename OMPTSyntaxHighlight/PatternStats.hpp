@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Statistics of one pattern, counted by the highlighter while it renders (see CellRenderer::Render).
+// Each block is aligned to a cache line, so the blocks of patterns highlighted on different threads never share one.
+struct alignas(64) PatternStats
+{
+	explicit PatternStats(std::string_view format = {}, int pattern = -1);
+
+	// Written as a JSON object
+	std::string ToJson() const;
+
+	std::string Format;
+	int Pattern = -1;
+
+	uint64_t Rows = 0;
+	uint64_t EmptyRows = 0;
+	std::vector<uint64_t> NotesPerChannel;
+
+	// Indexed by instrument number and by effect command character
+	std::array<uint64_t, 256> Instruments{};
+	std::array<uint64_t, 256> EffectCommands{};
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Inclusive ranges of numbers given on the command line, such as "1-4,9" or "16-" (open ended).
+// An empty list selects everything.
+struct RangeList
+{
+	std::vector<std::pair<int, int>> Ranges;
+
+	bool IsEmpty() const { return Ranges.empty(); }
+
+	bool Contains(const int Value) const
+	{
+		if (Ranges.empty()) return true;
+		for (const auto& [First, Last] : Ranges)
+		{
+			if (Value >= First && Value <= Last) return true;
+		}
+		return false;
+	}
+
+	// Largest selected value, so scans can stop early (INT_MAX when everything is selected)
+	int GetLast() const
+	{
+		int Last = Ranges.empty() ? INT_MAX : 0;
+		for (const auto& Range : Ranges) Last = std::max(Last, Range.second);
+		return Last;
+	}
+
+	static RangeList Parse(const std::string_view Text)
+	{
+		RangeList List;
+		size_t Start = 0;
+		while (Start < Text.size())
+		{
+			size_t End = Text.find(',', Start);
+			if (End == std::string_view::npos) End = Text.size();
+			const std::string_view Range = Text.substr(Start, End - Start);
+
+			const size_t Dash = Range.find('-');
+			const int First = ParseNumber(Range.substr(0, Dash));
+			int Last = First;
+			if (Dash != std::string_view::npos)
+				Last = (Dash + 1 == Range.size()) ? INT_MAX : ParseNumber(Range.substr(Dash + 1));
+
+			if (Last < First)
+				throw std::invalid_argument("Invalid range '" + std::string(Range) + "'");
+
+			List.Ranges.emplace_back(First, Last);
+			Start = End + 1;
+		}
+		return List;
+	}
+
+private:
+	static int ParseNumber(const std::string_view Text)
+	{
+		if (Text.empty() || Text.size() > 9 || Text.find_first_not_of("0123456789") != std::string_view::npos)
+			throw std::invalid_argument("Invalid number '" + std::string(Text) + "' in range list");
+		return std::stoi(std::string(Text));
+	}
+};
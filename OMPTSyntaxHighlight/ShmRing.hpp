@@ -0,0 +1,354 @@
+#pragma once
+
+// Single-producer/single-consumer ring buffer in POSIX shared memory, used to hand highlighted output to a
+// co-located consumer (such as a bot) without a pipe. Header-only so consumers can include it on its own.
+//
+// Records are framed as [uint32 length][uint32 flags][payload, padded to 8 bytes] and never wrap: when a record
+// does not fit before the end of the buffer a padding record fills the rest and the record starts at offset 0,
+// so the consumer always gets the payload as one contiguous view into the mapping. The padding is published on its
+// own, so the consumer releases the end of the buffer while the producer waits for space at the start.
+// Completed records are signalled through a futex in the shared header.
+// There is only ever one producer: it holds an exclusive flock on the segment while it exists, so a second producer
+// (another process writing to the same name) waits for the first one to finish instead of corrupting its records.
+//
+// The segment outlives both sides (it stays in /dev/shm, 64 MB by default) until it is unlinked. The producer never
+// unlinks it, since the consumer may not have read its records yet: the consumer owns the segment and removes it with
+// ShmRing::Unlink once it is done with the stream.
+//
+// Consumer usage:
+//     ShmRingConsumer Ring("/omptsh");
+//     while (auto Record = Ring.Read(std::chrono::seconds(1))) { Use(*Record); Ring.Release(); }
+//     ShmRing::Unlink("/omptsh");
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+	#include <cerrno>
+	#include <climits>
+	#include <fcntl.h>
+	#include <linux/futex.h>
+	#include <sys/file.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <thread>
+	#include <unistd.h>
+#endif
+
+constexpr uint32_t SHM_RING_MAGIC = 0x4F4D5052; // "OMPR"
+constexpr uint32_t SHM_RING_VERSION = 1;
+constexpr uint32_t SHM_RING_PADDING = 1;
+constexpr size_t SHM_RING_DEFAULT_CAPACITY = 64 << 20;
+constexpr size_t SHM_RING_RECORD_HEADER = 8;
+constexpr std::chrono::seconds SHM_RING_PRODUCER_WAIT(5);
+
+// Thrown for every failure of the ring buffer, so callers can tell them apart from their own errors
+class ShmRingError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+	"The ring buffer header is shared between processes and needs lock-free atomics");
+
+struct ShmRingHeader
+{
+	std::atomic<uint32_t> Magic;
+	uint32_t Version;
+	uint64_t Capacity;
+
+	// Producer and consumer positions grow forever, the offset in the buffer is Position % Capacity
+	alignas(64) std::atomic<uint64_t> Head;
+	alignas(64) std::atomic<uint64_t> Tail;
+
+	// Futex words, bumped whenever a record is published / released
+	alignas(64) std::atomic<uint32_t> Published;
+	alignas(64) std::atomic<uint32_t> Released;
+};
+
+// Maps (and creates if needed) the shared segment; base of the producer and consumer
+class ShmRing
+{
+public:
+	ShmRing(const ShmRing&) = delete;
+	ShmRing& operator=(const ShmRing&) = delete;
+
+	// Removes the segment's name, the memory is freed once every side has unmapped it. Returns false if there was none.
+	static bool Unlink(const std::string& name)
+	{
+#ifdef __linux__
+		return shm_unlink(name.c_str()) == 0;
+#else
+		(void)name;
+		return false;
+#endif
+	}
+
+protected:
+	ShmRing(const std::string& name, size_t capacity)
+	{
+#ifdef __linux__
+		capacity = (capacity + 7) & ~size_t{ 7 };
+
+		// Whoever creates the segment initializes it, the other side waits for the magic number
+		bool Created = true;
+		Fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (Fd < 0 && errno == EEXIST)
+		{
+			Created = false;
+			Fd = shm_open(name.c_str(), O_RDWR, 0600);
+		}
+		if (Fd < 0)
+			throw ShmRingError("Cannot open shared memory '" + name + "'");
+
+		if (Created && ftruncate(Fd, static_cast<off_t>(sizeof(ShmRingHeader) + capacity)) != 0)
+		{
+			close(Fd);
+			throw ShmRingError("Cannot size shared memory '" + name + "'");
+		}
+
+		// A segment created by the other side may not have been sized yet
+		struct stat Stat{};
+		for (int i = 0; i < 100 && fstat(Fd, &Stat) == 0; i++)
+		{
+			if (static_cast<size_t>(Stat.st_size) >= sizeof(ShmRingHeader)) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		MappedSize = static_cast<size_t>(Stat.st_size);
+		void* View = MappedSize >= sizeof(ShmRingHeader)
+			? mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0) : MAP_FAILED;
+		if (View == MAP_FAILED)
+		{
+			close(Fd);
+			throw ShmRingError("Cannot map shared memory '" + name + "'");
+		}
+
+		Header = static_cast<ShmRingHeader*>(View);
+		Data = static_cast<char*>(View) + sizeof(ShmRingHeader);
+
+		if (Created)
+		{
+			Header->Version = SHM_RING_VERSION;
+			Header->Capacity = capacity;
+			Header->Magic.store(SHM_RING_MAGIC, std::memory_order_release);
+		}
+		else
+		{
+			for (int i = 0; i < 100 && Header->Magic.load(std::memory_order_acquire) != SHM_RING_MAGIC; i++)
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+			if (Header->Magic.load(std::memory_order_acquire) != SHM_RING_MAGIC ||
+				Header->Version != SHM_RING_VERSION || sizeof(ShmRingHeader) + Header->Capacity > MappedSize)
+			{
+				munmap(View, MappedSize);
+				close(Fd);
+				throw ShmRingError("Shared memory '" + name + "' is not a compatible ring buffer");
+			}
+		}
+#else
+		(void)name;
+		(void)capacity;
+		throw ShmRingError("Shared memory output is only supported on Linux");
+#endif
+	}
+
+	~ShmRing()
+	{
+#ifdef __linux__
+		munmap(Header, MappedSize);
+		close(Fd);
+#endif
+	}
+
+	static size_t GetRecordSize(const size_t PayloadSize)
+	{
+		return (SHM_RING_RECORD_HEADER + PayloadSize + 7) & ~size_t{ 7 };
+	}
+
+	// Waits until Word differs from Expected or the timeout expires
+	static void Wait(std::atomic<uint32_t>& Word, const uint32_t Expected, const std::chrono::nanoseconds Timeout)
+	{
+#ifdef __linux__
+		const auto Seconds = std::chrono::duration_cast<std::chrono::seconds>(Timeout);
+		const timespec Time{ Seconds.count(), (Timeout - Seconds).count() };
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Word), FUTEX_WAIT, Expected, &Time, nullptr, 0);
+#else
+		(void)Word;
+		(void)Expected;
+		(void)Timeout;
+#endif
+	}
+
+	static void Wake(std::atomic<uint32_t>& Word)
+	{
+		Word.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+	}
+
+	// Kept open for the producer's lock
+	int Fd = -1;
+	ShmRingHeader* Header = nullptr;
+	char* Data = nullptr;
+	size_t MappedSize = 0;
+};
+
+class ShmRingProducer : public ShmRing
+{
+public:
+	explicit ShmRingProducer(const std::string& name, const size_t capacity = SHM_RING_DEFAULT_CAPACITY)
+		: ShmRing(name, capacity)
+	{
+#ifdef __linux__
+		// The lock goes away with the descriptor, so a producer that crashed never blocks the next one
+		const auto Deadline = std::chrono::steady_clock::now() + SHM_RING_PRODUCER_WAIT;
+		while (flock(Fd, LOCK_EX | LOCK_NB) != 0)
+		{
+			if (errno != EWOULDBLOCK || std::chrono::steady_clock::now() >= Deadline)
+				throw ShmRingError("Shared memory '" + name + "' is in use by another producer");
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+#endif
+	}
+
+	// Returns a contiguous writable region for a record of Size bytes, waiting up to Timeout for the consumer to free
+	// enough space. Nothing is visible to the consumer until Commit. Returns nullptr if the consumer did not free the
+	// space in time, throws ShmRingError if the record is larger than the whole buffer.
+	char* Reserve(const size_t Size, const std::chrono::milliseconds Timeout)
+	{
+		const uint64_t Capacity = Header->Capacity;
+		const uint64_t RecordSize = GetRecordSize(Size);
+		if (RecordSize > Capacity)
+			throw ShmRingError("Record of " + std::to_string(Size) + " bytes is larger than the shared memory ring buffer (" +
+				std::to_string(Capacity) + " bytes)");
+
+		const auto Deadline = std::chrono::steady_clock::now() + Timeout;
+		uint64_t Head = Header->Head.load(std::memory_order_relaxed);
+		const uint64_t Offset = Head % Capacity;
+
+		// Offsets are multiples of 8, so there is always room for the padding record's header
+		if (Offset + RecordSize > Capacity)
+		{
+			const uint64_t Padding = Capacity - Offset;
+			if (!WaitForSpace(Head, Padding, Deadline)) return nullptr;
+
+			const uint32_t PaddingHeader[2] = { 0, SHM_RING_PADDING };
+			std::memcpy(Data + Offset, PaddingHeader, sizeof(PaddingHeader));
+			Head += Padding;
+			Header->Head.store(Head, std::memory_order_release);
+			Wake(Header->Published);
+		}
+
+		if (!WaitForSpace(Head, RecordSize, Deadline)) return nullptr;
+
+		ReservedOffset = Head % Capacity;
+		return Data + ReservedOffset + SHM_RING_RECORD_HEADER;
+	}
+
+	// Publishes the record written into the last reserved region (Size may be smaller than what was reserved)
+	void Commit(const size_t Size)
+	{
+		const uint32_t RecordHeader[2] = { static_cast<uint32_t>(Size), 0 };
+		std::memcpy(Data + ReservedOffset, RecordHeader, sizeof(RecordHeader));
+
+		const uint64_t Head = Header->Head.load(std::memory_order_relaxed);
+		Header->Head.store(Head + GetRecordSize(Size), std::memory_order_release);
+		Wake(Header->Published);
+	}
+
+	// Copies a finished record in. Highlighted text is only known in size once it is rendered, so it is rendered into
+	// its own buffer and written with this single copy; Reserve/Commit are for records whose size is bounded up front.
+	bool Write(const std::string_view Record, const std::chrono::milliseconds Timeout = std::chrono::seconds(1))
+	{
+		char* Region = Reserve(Record.size(), Timeout);
+		if (Region == nullptr) return false;
+		std::memcpy(Region, Record.data(), Record.size());
+		Commit(Record.size());
+		return true;
+	}
+
+private:
+	// Waits until the consumer has released enough of the buffer for Needed bytes at Head
+	bool WaitForSpace(const uint64_t Head, const uint64_t Needed, const std::chrono::steady_clock::time_point Deadline)
+	{
+		while (true)
+		{
+			const uint32_t Released = Header->Released.load(std::memory_order_acquire);
+			const uint64_t Used = Head - Header->Tail.load(std::memory_order_acquire);
+			if (Header->Capacity - Used >= Needed) return true;
+
+			const auto Now = std::chrono::steady_clock::now();
+			if (Now >= Deadline) return false;
+			Wait(Header->Released, Released, Deadline - Now);
+		}
+	}
+
+	uint64_t ReservedOffset = 0;
+};
+
+class ShmRingConsumer : public ShmRing
+{
+public:
+	explicit ShmRingConsumer(const std::string& name, const size_t capacity = SHM_RING_DEFAULT_CAPACITY)
+		: ShmRing(name, capacity)
+	{
+	}
+
+	// Waits up to Timeout for the next record and returns a view of it inside the shared memory.
+	// The view stays valid until Release is called.
+	std::optional<std::string_view> Read(const std::chrono::milliseconds Timeout)
+	{
+		const uint64_t Capacity = Header->Capacity;
+		const auto Deadline = std::chrono::steady_clock::now() + Timeout;
+
+		while (true)
+		{
+			const uint32_t Published = Header->Published.load(std::memory_order_acquire);
+			const uint64_t Tail = Header->Tail.load(std::memory_order_relaxed);
+
+			if (Tail != Header->Head.load(std::memory_order_acquire))
+			{
+				const uint64_t Offset = Tail % Capacity;
+				uint32_t RecordHeader[2];
+				std::memcpy(RecordHeader, Data + Offset, sizeof(RecordHeader));
+
+				if (RecordHeader[1] == SHM_RING_PADDING)
+				{
+					Header->Tail.store(Tail + (Capacity - Offset), std::memory_order_release);
+					Wake(Header->Released);
+					continue;
+				}
+
+				CurrentSize = GetRecordSize(RecordHeader[0]);
+				return std::string_view(Data + Offset + SHM_RING_RECORD_HEADER, RecordHeader[0]);
+			}
+
+			const auto Now = std::chrono::steady_clock::now();
+			if (Now >= Deadline) return std::nullopt;
+			Wait(Header->Published, Published, Deadline - Now);
+		}
+	}
+
+	// Gives the space of the record returned by the last Read back to the producer
+	void Release()
+	{
+		const uint64_t Tail = Header->Tail.load(std::memory_order_relaxed);
+		Header->Tail.store(Tail + CurrentSize, std::memory_order_release);
+		CurrentSize = 0;
+		Wake(Header->Released);
+	}
+
+private:
+	uint64_t CurrentSize = 0;
+};
@@ -6,7 +6,16 @@
 #include <regex>
 #include <array>
 #include <cstring>
+#include <future>
+#include <memory>
+#include <optional>
 #include "clipboardxx.hpp"
+#include "ColorRules.hpp"
+#include "Highlighter.hpp"
+#include "ModuleReader.hpp"
+#include "RangeList.hpp"
+#include "ShmRing.hpp"
+#include "TerminalView.hpp"
 
 struct CLIOptions
 {
@@ -15,6 +24,15 @@ struct CLIOptions
 	bool USE_STDOUT = false;
 	bool AUTO_MARKDOWN = false;
 	bool REVERSE_MODE = false;
+	bool VIEW_MODE = false;
+	bool ANALYZE = false;
+	std::string MODULE_PATH;
+	std::string PATTERNS;
+	std::string ORDERS;
+	std::string CHANNELS;
+	std::string ROWS;
+	std::string RULES_PATH;
+	std::string SHM_NAME;
 };
 
 constexpr std::string_view HELP_MESSAGE =
@@ -26,9 +44,21 @@ constexpr std::string_view HELP_MESSAGE =
 "-o | --stdout     Write output to STDOUT instead of clipboard                 \n"
 "-d | --markdown   Wrap output in Markdown code block (for Discord)            \n"
 "-r | --reverse    Reverse mode (removes syntax highlighting instead of adding)\n"
+"-v | --view       Preview the highlighted pattern in the terminal (scrollable)\n"
+"--analyze         Write pattern statistics as JSON to STDERR                  \n"
+"--module FILE     Read pattern data from a MOD/XM/S3M/IT/MPTM file instead    \n"
+"--patterns LIST   Patterns to read from the module file (e.g. 0-3,7)          \n"
+"--orders LIST     Read the patterns played at these orders instead            \n"
+"--channels LIST   Channels to include (starting at 1, e.g. 1-4,9)             \n"
+"--rows LIST       Rows to include (starting at 0, e.g. 0-31)                  \n"
+"--rules FILE      Highlighting rules (format, column, characters, color slot) \n"
+"--shm NAME        Write output to a shared-memory ring buffer (Linux only)    \n"
 "--                End of options (next argument is treated as list of colors) \n"
 "                                                                              \n"
 "Using markdown does nothing if reverse mode is enabled.                       \n"
+"Patterns, channels and rows default to all of them.                           \n"
+"Module patterns are written one after another, separated by a blank line.     \n"
+"The preview only applies to clipboard/STDIN input, not to --module.           \n"
 "                                                                              \n"
 "Colors:                                                                       \n"
 "X,X,X,X,X,X,X,X  Each value from 0 to 15 (Discord only supports 0 to 7)       \n"
@@ -36,32 +66,29 @@ constexpr std::string_view HELP_MESSAGE =
 "if not provided: 7,5,4,2,6,3,1,7                                              \n";
 
 constexpr std::array DEFAULT_COLORS = { 7, 5, 4, 2, 6, 3, 1, 7 };
-constexpr std::string_view HEADER = "ModPlug Tracker ";
-constexpr std::array<std::string_view, 2> FORMATS_M = { "MOD", " XM" };
-constexpr std::array<std::string_view, 3>  FORMATS_S = { "S3M", " IT", "MPT" };
+constexpr std::array<std::string_view, 7> VALUE_OPTIONS = { "--module", "--patterns", "--orders", "--channels", "--rows", "--rules", "--shm" };
 
 CLIOptions ParseCommandLine(int argc, char* argv[]);
+int ProcessModule(const CLIOptions& Options, const ColorRules& Rules, const std::array<int, 8>& Colors,
+	std::optional<clipboardxx::async_clipboard>& Clipboard);
+bool IsValueOption(std::string_view arg);
 std::vector<std::string> Split(std::string_view s, char delimiter);
-std::string GetSGRCode(int color);
-int GetEffectCmdColor(char c, std::string_view f);
-int GetVolumeCmdColor(char c);
-int GetInstrumentColor(char c);
-int GetNoteColor(char c);
-bool isWhitespace(char c);
 bool StartsWith(std::string_view pre, std::string_view str);
 
 int main(int argc, char* argv[])
 {
 	int ColorArgIndex = 0;
 	
-	// Find the last provided argument and set its index as the color argument index
+	// Find the last provided argument and set its index as the color argument index (skipping option values)
 	for (int i = 1; i < argc; i++)
 	{
-		if (argv[i][0] != '-') ColorArgIndex = i;
+		if (IsValueOption(argv[i])) i++;
+		else if (argv[i][0] != '-') ColorArgIndex = i;
 	}
 
 	// Parse the cli options
-	auto [HELP, USE_STDIN, USE_STDOUT, AUTO_MARKDOWN, REVERSE_MODE] = ParseCommandLine(argc, argv);
+	const CLIOptions Options = ParseCommandLine(argc, argv);
+	const auto& [HELP, USE_STDIN, USE_STDOUT, AUTO_MARKDOWN, REVERSE_MODE, VIEW_MODE, ANALYZE, MODULE_PATH, PATTERNS, ORDERS, CHANNELS, ROWS, RULES_PATH, SHM_NAME] = Options;
 
 	// Show help (and then exit) if the help option is provided
 	if (HELP)
@@ -70,6 +97,23 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	// The preview shows a single pattern from the clipboard or STDIN
+	if (VIEW_MODE && !MODULE_PATH.empty())
+	{
+		std::cout << "The preview cannot be used with --module";
+		return 2;
+	}
+
+	// Get the clipboard going right away: connecting to X (and waiting for the current clipboard owner) then overlaps
+	// with parsing the colors and rules, reading STDIN and highlighting instead of coming after them
+	std::future<std::string> PendingPaste;
+	if (!USE_STDIN && MODULE_PATH.empty())
+		PendingPaste = clipboardxx::paste_async();
+
+	std::optional<clipboardxx::async_clipboard> Clipboard;
+	if (!USE_STDOUT && SHM_NAME.empty() && !VIEW_MODE)
+		Clipboard.emplace();
+
 	// Use the first non-option command-line argument as the list of colors
 	std::array<int, 8> Colors{};
 	try
@@ -84,7 +128,7 @@ int main(int argc, char* argv[])
 	}
 	catch (const std::exception& e)
 	{
-		if (!USE_STDOUT)
+		if (!USE_STDOUT && SHM_NAME.empty())
 			std::cout << e.what() << std::endl;
 		for (int i = 0; i < 8; i++)
 		{
@@ -92,6 +136,25 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	// Site-specific highlighting rules replace the built-in ones (compiled once, or loaded from their cache)
+	ColorRules Rules;
+	if (!RULES_PATH.empty())
+	{
+		try
+		{
+			Rules = ColorRules::Load(RULES_PATH);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << e.what();
+			return 2;
+		}
+	}
+
+	// Read the patterns straight from a module file instead of clipboard/STDIN
+	if (!MODULE_PATH.empty())
+		return ProcessModule(Options, Rules, Colors, Clipboard);
+
 	// Read clipboard/STDIN
 	std::string Input;
 	if (USE_STDIN)
@@ -113,10 +176,7 @@ int main(int argc, char* argv[])
 		}
 	}
 	else
-	{
-		clipboardxx::clipboard clipboard;
-		clipboard >> Input;
-	}
+		Input = PendingPaste.get();
 
 	// Try to get the module format and check if the data is valid OpenMPT pattern data
 	const std::string Format = Input.substr(HEADER.length(), 3);
@@ -126,61 +186,187 @@ int main(int argc, char* argv[])
 		return 2;
 	}
 
-	// Remove colors if the input is already syntax-highlighted
-	Input = std::regex_replace(Input, std::regex("\u001B\\[\\d+(;\\d+)*m"), "");
+	// Drop the rows and channels that were not asked for before doing any other work on them
+	if (!ROWS.empty() || !CHANNELS.empty())
+	{
+		try
+		{
+			Input = ProjectPattern(Input, RangeList::Parse(ROWS), RangeList::Parse(CHANNELS));
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << e.what();
+			return 2;
+		}
+	}
+
+	// Remove colors if the input is already syntax-highlighted (plain input, the usual case, is never run through the regex)
+	if (std::memchr(Input.data(), '\x1b', Input.size()) != nullptr)
+		Input = std::regex_replace(Input, std::regex("\u001B\\[\\d+(;\\d+)*m"), "");
+
+	const ColorTable Table(Rules, Colors, Format);
+	const auto Renderer = std::make_shared<PatternRenderer>(std::move(Input), Table);
 
-	// Add colors if reverse mode is not enabled
-	std::string Output;
-	if (!REVERSE_MODE)
+	// The statistics are counted by the highlighter in its own pass, so the pattern is highlighted right away
+	if (ANALYZE)
 	{
-		std::string resultbuilder;
-		int RelPos = -1;
-		int Color = -1;
-		int PreviousColor = -1;
+		PatternStats Stats(Format);
+		Renderer->Ansi(&Stats);
+		std::cerr << Stats.ToJson() << std::endl;
+	}
 
-		for (int i = 0; i < Input.length(); i++)
+	// Preview in the terminal instead of writing the output anywhere
+	if (VIEW_MODE)
+		return RunTerminalView(Renderer->Plain(), Table);
+
+	// Renders the requested representation: plain in reverse mode, otherwise highlighted (and optionally wrapped for Discord)
+	auto RenderOutput = [=]() -> std::string
+	{
+		if (REVERSE_MODE)
+			return Renderer->Plain();
+		if (AUTO_MARKDOWN)
+			return Renderer->Markdown();
+		return Renderer->Ansi();
+	};
+
+	// Write to shared memory/clipboard/STDOUT
+	if (!SHM_NAME.empty())
+	{
+		try
 		{
-			char c = Input[i];
-			if (c == '|') RelPos = 0;
+			// Written straight from the renderer's buffers, only the Markdown wrapping is built for the record
+			ShmRingProducer Ring(SHM_NAME);
+			const bool Written = (REVERSE_MODE || !AUTO_MARKDOWN)
+				? Ring.Write(REVERSE_MODE ? Renderer->Plain() : Renderer->Ansi())
+				: Ring.Write(Renderer->Markdown());
+			if (!Written)
+				throw ShmRingError("Shared memory ring buffer is full");
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << e.what();
+			return 4;
+		}
+	}
+	else if (USE_STDOUT)
+		std::cout << RenderOutput();
+	else
+	{
+		// Every other representation is offered through TARGETS as well and only rendered once a requestor asks for it.
+		// A background owner keeps serving them after we exit.
+		clipboardxx::ClipboardContent Content(RenderOutput);
+		Content.add_target(TARGET_PLAIN, [=] { return Renderer->Plain(); });
+		Content.add_target(TARGET_ANSI, [=] { return Renderer->Ansi(); });
+		Content.add_target(TARGET_MARKDOWN, [=] { return Renderer->Markdown(); });
+		Content.add_target(TARGET_HTML, [=] { return Renderer->Html(); });
+
+		// The requested representation is rendered here, while the connection may still be being set up
+		Content.text();
+		Clipboard->copy_detached(std::move(Content));
+	}
+}
 
-			if (RelPos == 0) Color = Colors[7];
-			if (RelPos == 1) Color = Colors[GetNoteColor(c)];
-			if (RelPos == 4) Color = Colors[GetInstrumentColor(c)];
-			if (RelPos == 6) Color = Colors[GetVolumeCmdColor(c)];
+int ProcessModule(const CLIOptions& Options, const ColorRules& Rules, const std::array<int, 8>& Colors,
+	std::optional<clipboardxx::async_clipboard>& Clipboard)
+{
+	try
+	{
+		const ModuleFile Module(Options.MODULE_PATH);
+		const RangeList Channels = RangeList::Parse(Options.CHANNELS);
+		const RangeList Rows = RangeList::Parse(Options.ROWS);
 
-			if (RelPos >= 9)
+		// Select the patterns either directly or through the order list
+		std::vector<size_t> Patterns;
+		if (!Options.ORDERS.empty())
+		{
+			const RangeList Orders = RangeList::Parse(Options.ORDERS);
+			for (const auto& [Order, Pattern] : Module.GetOrderPatterns())
 			{
-				if (RelPos % 3 == 0) Color = Colors[GetEffectCmdColor(c, Format)];
-				if (RelPos % 3 != 0 && c == '.' && Input[i - (RelPos % 3)] != '.') c = '0';
+				if (Orders.Contains(static_cast<int>(Order))) Patterns.push_back(Pattern);
 			}
-
-			if (!isWhitespace(c))
+		}
+		else
+		{
+			const RangeList Selected = RangeList::Parse(Options.PATTERNS);
+			for (size_t Pattern = 0; Pattern < Module.GetPatternCount(); Pattern++)
 			{
-				if (Color != PreviousColor) resultbuilder += GetSGRCode(Color);
-				PreviousColor = Color;
+				if (Selected.Contains(static_cast<int>(Pattern))) Patterns.push_back(Pattern);
 			}
+		}
 
-			resultbuilder += c;
-			if (RelPos >= 0) RelPos++;
+		// Every pattern gets its own statistics block, only ever touched by the thread highlighting it
+		std::vector<PatternStats> Stats;
+		if (Options.ANALYZE)
+		{
+			for (const size_t Pattern : Patterns)
+				Stats.emplace_back(Module.GetFormat(), static_cast<int>(Pattern));
 		}
 
-		Output = resultbuilder;
-	}
-	else
-		Output = Input;
+		// Highlight on the decoding threads, write out in order as soon as each pattern is ready
+		const ColorTable Table(Rules, Colors, Module.GetFormat());
+		auto Render = [&](const size_t Index, std::string Text) -> std::string
+		{
+			PatternStats* Block = Options.ANALYZE ? &Stats[Index] : nullptr;
+			if (Options.REVERSE_MODE)
+			{
+				if (Block != nullptr) Highlight(Text, Table, Block);
+				return Text;
+			}
+			if (Options.AUTO_MARKDOWN)
+				return WrapMarkdown(Highlight(Text, Table, Block));
+			return Highlight(Text, Table, Block);
+		};
+
+		// Each pattern is a record of its own in shared memory
+		std::optional<ShmRingProducer> Ring;
+		if (!Options.SHM_NAME.empty())
+			Ring.emplace(Options.SHM_NAME);
+
+		std::string Output;
+		StreamPatterns(Module, Patterns, Rows, Channels, Render, [&](const std::string& Text)
+		{
+			if (Ring.has_value())
+			{
+				if (!Ring->Write(Text))
+					throw ShmRingError("Shared memory ring buffer is full");
+			}
+			else if (Options.USE_STDOUT)
+				std::cout << Text << "\r\n";
+			else
+				Output += Text + "\r\n";
+		});
 
-	// Wrap in code block for Discord if specified
-	if (AUTO_MARKDOWN && !REVERSE_MODE)
-		Output = "```ansi\n" +  Output + "```";
+		if (Options.ANALYZE)
+		{
+			std::string Json = "[";
+			for (size_t i = 0; i < Stats.size(); i++)
+				Json += (i > 0 ? "," : "") + Stats[i].ToJson();
+			std::cerr << Json << ']' << std::endl;
+		}
 
-	// Write to clipboard/STDOUT
-	if (USE_STDOUT)
-		std::cout << Output;
-	else
+		if (Clipboard.has_value())
+		{
+			Clipboard->copy_detached(Output);
+		}
+	}
+	catch (const ShmRingError& e)
+	{
+		// Same exit code as for clipboard/STDIN input
+		std::cout << e.what();
+		return 4;
+	}
+	catch (const std::exception& e)
 	{
-		clipboardxx::clipboard clipboard;
-		clipboard << Output;
+		std::cout << e.what();
+		return 2;
 	}
+
+	return 0;
+}
+
+bool IsValueOption(const std::string_view arg)
+{
+	return std::ranges::find(VALUE_OPTIONS, arg) != VALUE_OPTIONS.end();
 }
 
 inline bool StartsWith(const std::string_view pre, const std::string_view str)
@@ -193,13 +379,27 @@ CLIOptions ParseCommandLine(const int argc, char* argv[])
 	CLIOptions options;
 	for (int i = 1; i < argc; i++)
 	{
-		if (StartsWith("--", argv[i]))
+		if (IsValueOption(argv[i]))
+		{
+			const std::string Value = (i + 1 < argc) ? argv[i + 1] : "";
+			if (strcmp(argv[i], "--module") == 0)				options.MODULE_PATH = Value;
+			else if (strcmp(argv[i], "--patterns") == 0)		options.PATTERNS = Value;
+			else if (strcmp(argv[i], "--orders") == 0)			options.ORDERS = Value;
+			else if (strcmp(argv[i], "--channels") == 0)		options.CHANNELS = Value;
+			else if (strcmp(argv[i], "--rows") == 0)			options.ROWS = Value;
+			else if (strcmp(argv[i], "--rules") == 0)			options.RULES_PATH = Value;
+			else if (strcmp(argv[i], "--shm") == 0)				options.SHM_NAME = Value;
+			i++;
+		}
+		else if (StartsWith("--", argv[i]))
 		{
 			if (strcmp(argv[i], "--help") == 0)					options.HELP = true;
 			else if (strcmp(argv[i], "--stdin") == 0)			options.USE_STDIN = true;
 			else if (strcmp(argv[i], "--stdout") == 0)			options.USE_STDOUT = true;
 			else if (strcmp(argv[i], "--markdown") == 0)		options.AUTO_MARKDOWN = true;
 			else if (strcmp(argv[i], "--reverse") == 0)			options.REVERSE_MODE = true;
+			else if (strcmp(argv[i], "--view") == 0)			options.VIEW_MODE = true;
+			else if (strcmp(argv[i], "--analyze") == 0)			options.ANALYZE = true;
 
 		}
 		else if (StartsWith("-", argv[i]))
@@ -211,6 +411,7 @@ CLIOptions ParseCommandLine(const int argc, char* argv[])
 				else if (argv[i][j] == 'o')						options.USE_STDOUT = true;
 				else if (argv[i][j] == 'm')						options.AUTO_MARKDOWN = true;
 				else if (argv[i][j] == 'r')						options.REVERSE_MODE = true;
+				else if (argv[i][j] == 'v')						options.VIEW_MODE = true;
 			}
 		}
 	}
@@ -228,64 +429,3 @@ std::vector<std::string> Split(const std::string_view s, const char delimiter)
 	}
 	return tokens;
 }
-
-bool isWhitespace(const char c)
-{
-	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
-}
-
-std::string GetSGRCode(const int color)
-{
-	return "\u001B[" + std::to_string(color + ((color < 8) ? 30 : 82)) + "m";
-}
-
-int GetNoteColor(const char c)
-{
-	return (c >= 'A' && c <= 'G') ? 1 : 0;
-}
-
-int GetInstrumentColor(const char c)
-{
-	return c >= '0' ? 2 : 0;
-}
-
-int GetVolumeCmdColor(const char c)
-{
-	int color = 0;
-	
-	switch (c)
-	{
-		case 'a': case 'b': case 'c': case 'd': case 'v': color = 3; break;
-		case 'l': case 'p': case 'r': color = 4; break;
-		case 'e': case 'f': case 'g': case 'h': case 'u': color = 5; break;
-	}
-
-	return color;
-}
-
-int GetEffectCmdColor(const char c, const std::string_view f)
-{
-	int color = 0;
-	if (std::ranges::find(FORMATS_S, f) != FORMATS_S.end())
-	{
-		switch (c)
-		{
-			case 'D': case 'K': case 'L': case 'M': case 'N': case 'R': color = 3; break;
-			case 'P': case 'X': case 'Y': color = 4; break;
-			case 'E': case 'F': case 'G': case 'H': case 'U': case '+': case '*': color = 5; break;
-			case 'A': case 'B': case 'C': case 'T': case 'V': case 'W': color = 6; break;
-		}
-	}
-	else if (std::ranges::find(FORMATS_M, f) != FORMATS_M.end())
-	{
-		switch (c)
-		{
-			case '5': case '6': case '7': case 'A': case 'C': color = 3; break;
-			case '8': case 'P': case 'Y': color = 4; break;
-			case '1': case '2': case '3': case '4': case 'X': color = 5; break;
-			case 'B': case 'D': case 'F': case 'G': case 'H': color = 6; break;
-		}
-	}
-	
-	return color;
-}
\ No newline at end of file
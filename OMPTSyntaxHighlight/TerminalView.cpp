@@ -0,0 +1,398 @@
+#include "TerminalView.hpp"
+#include "Highlighter.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32) || defined(WIN32)
+	#include <conio.h>
+	// std::min/std::max are used below, keep windows.h from defining them as macros
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <csignal>
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <sys/ioctl.h>
+	#include <termios.h>
+	#include <unistd.h>
+#endif
+
+enum class Key { None, Quit, Up, Down, Left, Right, PageUp, PageDown, Home, End };
+
+constexpr size_t ROW_CACHE_LIMIT = 4096;
+constexpr int ROW_NUMBER_WIDTH = 5;
+constexpr std::string_view ENTER_VIEW = "\u001B[?1049h\u001B[?25l";
+constexpr std::string_view LEAVE_VIEW = "\u001B[0m\u001B[?25h\u001B[?1049l";
+constexpr std::string_view KEY_HELP = "arrows/hjkl scroll, PgUp/PgDn, Home/End, q quit";
+
+// Terminal in raw mode, used for drawing the preview and reading keys. The previous mode is restored on destruction.
+class Terminal
+{
+public:
+	Terminal();
+	~Terminal();
+
+	bool IsOpen() const;
+	void Write(std::string_view Text) const;
+	std::pair<int, int> GetSize() const;
+	Key ReadKey() const;
+
+private:
+#if defined(_WIN32) || defined(WIN32)
+	HANDLE Output = INVALID_HANDLE_VALUE;
+	DWORD PreviousMode = 0;
+#else
+	int Fd = -1;
+	termios PreviousMode{};
+#endif
+};
+
+// The visible part of a pattern, rendered row by row on demand
+class PatternView
+{
+public:
+	PatternView(std::string_view input, const ColorTable& colors);
+
+	std::string Draw(int Columns, int Lines);
+	void Scroll(Key key, int ViewLines);
+
+private:
+	std::string_view GetLine(size_t Line) const;
+	const std::string& RenderRow(size_t Row, int Width);
+
+	const std::string_view Input;
+	CellRenderer Cells;
+
+	std::vector<size_t> LineStarts;
+	size_t RowCount = 0;
+	size_t ChannelCount = 0;
+	size_t TopRow = 0;
+	size_t FirstChannel = 0;
+
+	std::unordered_map<uint64_t, std::string> RowCache;
+	int CachedWidth = -1;
+};
+
+int RunTerminalView(const std::string_view Input, const ColorTable& Colors)
+{
+	const Terminal terminal;
+	if (!terminal.IsOpen())
+	{
+		std::cout << "Cannot open the terminal for the preview.";
+		return 3;
+	}
+
+	PatternView View(Input, Colors);
+	terminal.Write(ENTER_VIEW);
+
+	while (true)
+	{
+		const auto [Columns, Lines] = terminal.GetSize();
+		terminal.Write(View.Draw(Columns, Lines));
+
+		const Key key = terminal.ReadKey();
+		if (key == Key::Quit) break;
+		View.Scroll(key, Lines - 1);
+	}
+
+	terminal.Write(LEAVE_VIEW);
+	return 0;
+}
+
+PatternView::PatternView(const std::string_view input, const ColorTable& colors)
+	: Input(input), Cells(colors)
+{
+	// Index the line offsets once, the first line is the header and every following one is a pattern row
+	LineStarts.push_back(0);
+	for (const char* p = Input.data(), *End = Input.data() + Input.size();
+		(p = static_cast<const char*>(std::memchr(p, '\n', End - p))) != nullptr; p++)
+	{
+		LineStarts.push_back(p - Input.data() + 1);
+	}
+
+	RowCount = LineStarts.size() - 1;
+	if (RowCount > 0)
+	{
+		const std::string_view FirstRow = GetLine(1);
+		ChannelCount = std::ranges::count(FirstRow, '|');
+	}
+}
+
+std::string_view PatternView::GetLine(const size_t Line) const
+{
+	const size_t Start = LineStarts[Line];
+	const size_t End = (Line + 1 < LineStarts.size()) ? LineStarts[Line + 1] - 1 : Input.size();
+	std::string_view Text = Input.substr(Start, End - Start);
+	if (!Text.empty() && Text.back() == '\r') Text.remove_suffix(1);
+	return Text;
+}
+
+const std::string& PatternView::RenderRow(const size_t Row, const int Width)
+{
+	if (Width != CachedWidth || RowCache.size() >= ROW_CACHE_LIMIT)
+	{
+		RowCache.clear();
+		CachedWidth = Width;
+	}
+
+	const uint64_t CacheKey = (static_cast<uint64_t>(Row) << 16) | FirstChannel;
+	const auto Cached = RowCache.find(CacheKey);
+	if (Cached != RowCache.end()) return Cached->second;
+
+	// Jump to the first visible channel and only highlight what fits in the viewport
+	const std::string_view Line = GetLine(Row + 1);
+	size_t Start = Line.find('|');
+	for (size_t i = 0; i < FirstChannel && Start != std::string_view::npos; i++)
+		Start = Line.find('|', Start + 1);
+
+	std::string RowNumber = std::to_string(Row);
+	RowNumber.insert(0, std::max(0, ROW_NUMBER_WIDTH - 1 - static_cast<int>(RowNumber.size())), ' ');
+
+	std::string Rendered = "\u001B[0m" + RowNumber + ' ';
+	if (Start != std::string_view::npos)
+		Cells.Render(Rendered, Line.substr(Start, std::max(0, Width)));
+	Rendered += "\u001B[0m";
+
+	return RowCache.emplace(CacheKey, std::move(Rendered)).first->second;
+}
+
+std::string PatternView::Draw(const int Columns, const int Lines)
+{
+	const int ViewLines = std::max(1, Lines - 1);
+	std::string Frame = "\u001B[H";
+
+	for (int i = 0; i < ViewLines; i++)
+	{
+		const size_t Row = TopRow + i;
+		if (Row < RowCount) Frame += RenderRow(Row, Columns - ROW_NUMBER_WIDTH);
+		Frame += "\u001B[K\n";
+	}
+
+	const size_t LastRow = std::min(RowCount, TopRow + ViewLines);
+	std::string Status = std::string(GetLine(0)) + " | rows " + std::to_string(TopRow) + "-" +
+		std::to_string(LastRow == 0 ? 0 : LastRow - 1) + " of " + std::to_string(RowCount) +
+		" | channels from " + std::to_string(FirstChannel + 1) + " of " + std::to_string(ChannelCount) +
+		" | " + std::string(KEY_HELP);
+	Status.resize(std::max(0, Columns), ' ');
+
+	Frame += "\u001B[7m" + Status + "\u001B[0m";
+	return Frame;
+}
+
+void PatternView::Scroll(const Key key, const int ViewLines)
+{
+	const size_t Page = std::max(1, ViewLines);
+	const size_t LastTopRow = RowCount > Page ? RowCount - Page : 0;
+	const size_t LastChannel = ChannelCount > 0 ? ChannelCount - 1 : 0;
+
+	switch (key)
+	{
+		case Key::Up: TopRow = TopRow > 0 ? TopRow - 1 : 0; break;
+		case Key::Down: TopRow = std::min(TopRow + 1, LastTopRow); break;
+		case Key::PageUp: TopRow = TopRow > Page ? TopRow - Page : 0; break;
+		case Key::PageDown: TopRow = std::min(TopRow + Page, LastTopRow); break;
+		case Key::Left: FirstChannel = FirstChannel > 0 ? FirstChannel - 1 : 0; break;
+		case Key::Right: FirstChannel = std::min(FirstChannel + 1, LastChannel); break;
+		case Key::Home: TopRow = 0; FirstChannel = 0; break;
+		case Key::End: TopRow = LastTopRow; break;
+		case Key::None: case Key::Quit: break;
+	}
+}
+
+#if defined(_WIN32) || defined(WIN32)
+
+Terminal::Terminal() : Output(GetStdHandle(STD_OUTPUT_HANDLE))
+{
+	if (Output == INVALID_HANDLE_VALUE || !GetConsoleMode(Output, &PreviousMode))
+	{
+		Output = INVALID_HANDLE_VALUE;
+		return;
+	}
+	SetConsoleMode(Output, PreviousMode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+	// Ctrl+C is read as a key (3) that quits, so the console is always restored
+	SetConsoleCtrlHandler(nullptr, TRUE);
+}
+
+Terminal::~Terminal()
+{
+	if (!IsOpen()) return;
+	SetConsoleCtrlHandler(nullptr, FALSE);
+	SetConsoleMode(Output, PreviousMode);
+}
+
+bool Terminal::IsOpen() const
+{
+	return Output != INVALID_HANDLE_VALUE;
+}
+
+void Terminal::Write(const std::string_view Text) const
+{
+	DWORD Written = 0;
+	WriteConsoleA(Output, Text.data(), static_cast<DWORD>(Text.size()), &Written, nullptr);
+}
+
+std::pair<int, int> Terminal::GetSize() const
+{
+	CONSOLE_SCREEN_BUFFER_INFO Info{};
+	if (!GetConsoleScreenBufferInfo(Output, &Info)) return { 80, 24 };
+	return { Info.srWindow.Right - Info.srWindow.Left + 1, Info.srWindow.Bottom - Info.srWindow.Top + 1 };
+}
+
+Key Terminal::ReadKey() const
+{
+	const int c = _getch();
+	if (c == 0 || c == 0xE0)
+	{
+		switch (_getch())
+		{
+			case 72: return Key::Up;
+			case 80: return Key::Down;
+			case 75: return Key::Left;
+			case 77: return Key::Right;
+			case 73: return Key::PageUp;
+			case 81: return Key::PageDown;
+			case 71: return Key::Home;
+			case 79: return Key::End;
+			default: return Key::None;
+		}
+	}
+
+	switch (c)
+	{
+		case 'q': case 'Q': case 27: case 3: return Key::Quit;
+		case 'k': return Key::Up;
+		case 'j': return Key::Down;
+		case 'h': return Key::Left;
+		case 'l': return Key::Right;
+		case 'b': return Key::PageUp;
+		case ' ': return Key::PageDown;
+		case 'g': return Key::Home;
+		case 'G': return Key::End;
+		default: return Key::None;
+	}
+}
+
+#else
+
+// Interrupts the blocking key read so the view is redrawn with the new size
+extern "C" void OnTerminalResize(int) {}
+
+Terminal::Terminal() : Fd(open("/dev/tty", O_RDWR))
+{
+	if (Fd < 0 || tcgetattr(Fd, &PreviousMode) != 0)
+	{
+		if (Fd >= 0) close(Fd);
+		Fd = -1;
+		return;
+	}
+
+	// Without ISIG, Ctrl+C arrives as a key (3) that quits, so the terminal is always restored instead of being left
+	// in the alternate screen with echo off
+	termios Raw = PreviousMode;
+	Raw.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO | ISIG);
+	Raw.c_cc[VMIN] = 1;
+	Raw.c_cc[VTIME] = 0;
+	tcsetattr(Fd, TCSANOW, &Raw);
+
+	struct sigaction Action{};
+	Action.sa_handler = OnTerminalResize;
+	sigaction(SIGWINCH, &Action, nullptr);
+}
+
+Terminal::~Terminal()
+{
+	if (!IsOpen()) return;
+	tcsetattr(Fd, TCSANOW, &PreviousMode);
+	close(Fd);
+}
+
+bool Terminal::IsOpen() const
+{
+	return Fd >= 0;
+}
+
+void Terminal::Write(std::string_view Text) const
+{
+	while (!Text.empty())
+	{
+		const ssize_t Written = write(Fd, Text.data(), Text.size());
+		if (Written <= 0) return;
+		Text.remove_prefix(static_cast<size_t>(Written));
+	}
+}
+
+std::pair<int, int> Terminal::GetSize() const
+{
+	winsize Size{};
+	if (ioctl(Fd, TIOCGWINSZ, &Size) != 0 || Size.ws_col == 0) return { 80, 24 };
+	return { Size.ws_col, Size.ws_row };
+}
+
+Key Terminal::ReadKey() const
+{
+	// Bytes of an escape sequence arrive together, a lone ESC is a key press of its own
+	auto ReadByte = [this](const int Timeout) -> int
+	{
+		pollfd Poll{ Fd, POLLIN, 0 };
+		unsigned char c = 0;
+		if (Timeout >= 0 && poll(&Poll, 1, Timeout) <= 0) return -1;
+		return read(Fd, &c, 1) == 1 ? c : -1;
+	};
+
+	const int c = ReadByte(-1);
+	if (c == -1) return errno == EINTR ? Key::None : Key::Quit;
+	if (c == 27)
+	{
+		const int Intro = ReadByte(50);
+		if (Intro == -1) return Key::Quit;
+		if (Intro != '[' && Intro != 'O') return Key::None;
+
+		int Code = ReadByte(50);
+		if (Code >= '0' && Code <= '9')
+		{
+			const int Digit = Code;
+			while (Code != -1 && Code != '~') Code = ReadByte(50);
+			Code = Digit;
+		}
+
+		switch (Code)
+		{
+			case 'A': return Key::Up;
+			case 'B': return Key::Down;
+			case 'C': return Key::Right;
+			case 'D': return Key::Left;
+			case 'H': case '1': return Key::Home;
+			case 'F': case '4': return Key::End;
+			case '5': return Key::PageUp;
+			case '6': return Key::PageDown;
+			default: return Key::None;
+		}
+	}
+
+	switch (c)
+	{
+		case 'q': case 'Q': case 3: return Key::Quit;
+		case 'k': return Key::Up;
+		case 'j': return Key::Down;
+		case 'h': return Key::Left;
+		case 'l': return Key::Right;
+		case 'b': return Key::PageUp;
+		case ' ': return Key::PageDown;
+		case 'g': return Key::Home;
+		case 'G': return Key::End;
+		default: return Key::None;
+	}
+}
+
+#endif
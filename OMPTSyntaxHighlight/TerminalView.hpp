@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ColorRules.hpp"
+
+#include <string_view>
+
+// Interactive preview of (already stripped) pattern data in the terminal.
+// Row offsets are indexed once, only the rows and channels inside the viewport are highlighted, and every rendered
+// row is cached, so scrolling costs the same regardless of the size of the input.
+// Returns the process exit code.
+int RunTerminalView(std::string_view Input, const ColorTable& Colors);
@@ -0,0 +1,370 @@
+// Latency and throughput benchmark of the X11 clipboard code (Xcb, X11EventHandler, X11Provider).
+// Uses $DISPLAY if set, otherwise starts a private Xvfb (or Xephyr) server for the duration of the run.
+// Results are written to STDOUT as JSON, with percentiles in microseconds.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <csignal>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <xcb/xcb.h>
+
+#include "clipboardxx.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<size_t, 6> PAYLOAD_SIZES = { 1 << 10, 64 << 10, 1 << 20, 4 << 20, 16 << 20, 32 << 20 };
+constexpr std::array<size_t, 3> REQUESTOR_COUNTS = { 1, 4, 16 };
+constexpr std::chrono::duration SERVER_START_TIMEOUT = std::chrono::seconds(5);
+constexpr std::chrono::duration REQUEST_TIMEOUT = std::chrono::seconds(10);
+
+struct Result
+{
+	std::string Name;
+	std::vector<double> Samples;
+	size_t Bytes = 0;
+	size_t Failures = 0;
+	bool Skipped = false;
+};
+
+// A private X server, started only if there is no $DISPLAY to reuse and stopped again on destruction
+class VirtualDisplay
+{
+public:
+	VirtualDisplay();
+	~VirtualDisplay();
+
+	const std::string& GetName() const { return Name; }
+
+private:
+	std::string Name;
+	pid_t Server = -1;
+};
+
+// Raw XCB client asking the clipboard owner for data, the way another application would
+class Requestor
+{
+public:
+	Requestor();
+	~Requestor();
+
+	// Asks for UTF8_STRING and returns the number of bytes received, or -1 if the owner refused or did not answer
+	long Request();
+
+	// Largest payload the X server accepts in a single property change
+	size_t GetMaximumRequestBytes() const;
+
+private:
+	xcb_atom_t Intern(const std::string& Name) const;
+
+	xcb_connection_t* Connection = nullptr;
+	xcb_window_t Window = 0;
+	xcb_atom_t Clipboard = 0;
+	xcb_atom_t Target = 0;
+	xcb_atom_t Property = 0;
+};
+
+double MicrosecondsSince(Clock::time_point Start);
+std::string ToJson(const std::vector<Result>& Results, const std::string& Display);
+
+int main(int argc, char* argv[])
+{
+	size_t Iterations = 50;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--iterations") == 0) Iterations = std::max(1, std::atoi(argv[i + 1]));
+	}
+
+	try
+	{
+		const VirtualDisplay Display;
+		std::vector<Result> Results;
+
+		// Connection and atom setup
+		Result Connect{ "connect", {} }, Atoms{ "atom_setup", {} }, Provider{ "provider_setup", {} };
+		for (size_t i = 0; i < Iterations; i++)
+		{
+			Clock::time_point Start = Clock::now();
+			auto Xcb = std::make_shared<clipboardxx::xcb::Xcb>();
+			Connect.Samples.push_back(MicrosecondsSince(Start));
+
+			Start = Clock::now();
+			for (const char* Name : clipboardxx::kSupportedTextFormats)
+				Xcb->create_atom(Name);
+			for (const char* Name : { "CLIPBOARD", "BUFFER", "TARGETS", "ATOM" })
+				Xcb->create_atom(Name);
+			Atoms.Samples.push_back(MicrosecondsSince(Start));
+
+			Start = Clock::now();
+			const clipboardxx::X11Provider Instance;
+			Provider.Samples.push_back(MicrosecondsSince(Start));
+		}
+		Results.insert(Results.end(), { Connect, Atoms, Provider });
+
+		// Paste round trip through the provider itself, with another provider owning the clipboard
+		clipboardxx::X11Provider Owner;
+		{
+			Result Paste{ "paste_round_trip", {}, 1 << 10 };
+			const std::string Payload(Paste.Bytes, 'x');
+			Owner.copy(clipboardxx::ClipboardContent(Payload));
+
+			clipboardxx::X11Provider Pasting;
+			for (size_t i = 0; i < Iterations; i++)
+			{
+				const Clock::time_point Start = Clock::now();
+				const std::string Pasted = Pasting.paste();
+				if (Pasted.size() == Payload.size()) Paste.Samples.push_back(MicrosecondsSince(Start));
+				else Paste.Failures++;
+			}
+			Results.push_back(Paste);
+		}
+
+		// Copy-serve latency and throughput as seen by a raw requestor, per payload size.
+		// Payloads the server cannot take in one request would close the owner's connection, so they are skipped.
+		Requestor Client;
+		for (const size_t Bytes : PAYLOAD_SIZES)
+		{
+			Result Serve{ "copy_serve_" + std::to_string(Bytes >> 10) + "k", {}, Bytes };
+			if (Bytes > Client.GetMaximumRequestBytes())
+			{
+				Serve.Skipped = true;
+				Results.push_back(Serve);
+				continue;
+			}
+
+			Owner.copy(clipboardxx::ClipboardContent(std::string(Bytes, 'x')));
+
+			const size_t Runs = Bytes >= (1 << 20) ? std::max<size_t>(Iterations / 10, 3) : Iterations;
+			for (size_t i = 0; i < Runs; i++)
+			{
+				const Clock::time_point Start = Clock::now();
+				if (Client.Request() == static_cast<long>(Bytes)) Serve.Samples.push_back(MicrosecondsSince(Start));
+				else Serve.Failures++;
+			}
+			Results.push_back(Serve);
+		}
+
+		// Many requestors asking at the same time
+		Owner.copy(clipboardxx::ClipboardContent(std::string(64 << 10, 'x')));
+		for (const size_t Count : REQUESTOR_COUNTS)
+		{
+			Result Concurrent{ "concurrent_" + std::to_string(Count), {}, 64 << 10 };
+			std::vector<std::vector<double>> Samples(Count);
+			std::atomic<size_t> Failures = 0;
+			std::vector<std::thread> Threads;
+
+			for (size_t t = 0; t < Count; t++)
+			{
+				Threads.emplace_back([&, t]
+				{
+					Requestor ThreadClient;
+					for (size_t i = 0; i < Iterations; i++)
+					{
+						const Clock::time_point Start = Clock::now();
+						if (ThreadClient.Request() == static_cast<long>(Concurrent.Bytes))
+							Samples[t].push_back(MicrosecondsSince(Start));
+						else
+							Failures++;
+					}
+				});
+			}
+			for (std::thread& Thread : Threads)
+				Thread.join();
+
+			for (const std::vector<double>& ThreadSamples : Samples)
+				Concurrent.Samples.insert(Concurrent.Samples.end(), ThreadSamples.begin(), ThreadSamples.end());
+			Concurrent.Failures = Failures;
+			Results.push_back(Concurrent);
+		}
+
+		std::cout << ToJson(Results, Display.GetName()) << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+VirtualDisplay::VirtualDisplay()
+{
+	if (const char* Existing = std::getenv("DISPLAY"); Existing != nullptr && *Existing != '\0')
+	{
+		Name = Existing;
+		return;
+	}
+
+	// Pick the first display number without a socket
+	int Number = 99;
+	struct stat Stat{};
+	while (stat(("/tmp/.X11-unix/X" + std::to_string(Number)).c_str(), &Stat) == 0)
+		Number++;
+	Name = ":" + std::to_string(Number);
+
+	Server = fork();
+	if (Server == 0)
+	{
+		execlp("Xvfb", "Xvfb", Name.c_str(), "-nolisten", "tcp", "-screen", "0", "640x480x24", nullptr);
+		execlp("Xephyr", "Xephyr", Name.c_str(), "-nolisten", "tcp", nullptr);
+		_exit(127);
+	}
+	if (Server < 0)
+		throw std::runtime_error("Cannot start a virtual X server");
+
+	// Wait until the server accepts connections
+	const Clock::time_point Start = Clock::now();
+	while (true)
+	{
+		xcb_connection_t* Connection = xcb_connect(Name.c_str(), nullptr);
+		const bool Ready = xcb_connection_has_error(Connection) == 0;
+		xcb_disconnect(Connection);
+		if (Ready) break;
+
+		int Status = 0;
+		if (waitpid(Server, &Status, WNOHANG) == Server || Clock::now() - Start > SERVER_START_TIMEOUT)
+		{
+			kill(Server, SIGKILL);
+			waitpid(Server, nullptr, 0);
+			Server = -1;
+			throw std::runtime_error("Cannot start a virtual X server (is Xvfb or Xephyr installed?)");
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	setenv("DISPLAY", Name.c_str(), 1);
+}
+
+VirtualDisplay::~VirtualDisplay()
+{
+	if (Server <= 0) return;
+	kill(Server, SIGTERM);
+	waitpid(Server, nullptr, 0);
+}
+
+Requestor::Requestor() : Connection(xcb_connect(nullptr, nullptr))
+{
+	if (xcb_connection_has_error(Connection))
+		throw std::runtime_error("Cannot connect to X server");
+
+	xcb_screen_t* Screen = xcb_setup_roots_iterator(xcb_get_setup(Connection)).data;
+	Window = xcb_generate_id(Connection);
+	const uint32_t EventMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+	xcb_create_window(Connection, XCB_COPY_FROM_PARENT, Window, Screen->root, 0, 0, 1, 1, 0,
+		XCB_WINDOW_CLASS_COPY_FROM_PARENT, Screen->root_visual, XCB_CW_EVENT_MASK, &EventMask);
+
+	Clipboard = Intern("CLIPBOARD");
+	Target = Intern("UTF8_STRING");
+	Property = Intern("BENCHMARK_BUFFER");
+}
+
+Requestor::~Requestor()
+{
+	xcb_disconnect(Connection);
+}
+
+xcb_atom_t Requestor::Intern(const std::string& Name) const
+{
+	const xcb_intern_atom_cookie_t Cookie =
+		xcb_intern_atom(Connection, 0, static_cast<uint16_t>(Name.size()), Name.c_str());
+	xcb_intern_atom_reply_t* Reply = xcb_intern_atom_reply(Connection, Cookie, nullptr);
+	const xcb_atom_t Atom = Reply != nullptr ? Reply->atom : xcb_atom_t{ XCB_ATOM_NONE };
+	std::free(Reply);
+	return Atom;
+}
+
+size_t Requestor::GetMaximumRequestBytes() const
+{
+	// Leave room for the ChangeProperty request header
+	return static_cast<size_t>(xcb_get_maximum_request_length(Connection)) * 4 - 64;
+}
+
+long Requestor::Request()
+{
+	xcb_convert_selection(Connection, Window, Clipboard, Target, Property, XCB_CURRENT_TIME);
+	xcb_flush(Connection);
+
+	// Sleep on the connection until the owner's SelectionNotify arrives
+	const Clock::time_point Start = Clock::now();
+	while (Clock::now() - Start < REQUEST_TIMEOUT)
+	{
+		if (xcb_connection_has_error(Connection)) return -1;
+		xcb_generic_event_t* Event = xcb_poll_for_event(Connection);
+		if (Event == nullptr)
+		{
+			pollfd Poll{ xcb_get_file_descriptor(Connection), POLLIN, 0 };
+			poll(&Poll, 1, 100);
+			continue;
+		}
+
+		const bool Notified = (Event->response_type & 0x7F) == XCB_SELECTION_NOTIFY;
+		const bool Refused = Notified && reinterpret_cast<xcb_selection_notify_event_t*>(Event)->property == XCB_NONE;
+		std::free(Event);
+		if (Refused) return -1;
+		if (!Notified) continue;
+
+		const xcb_get_property_cookie_t Cookie =
+			xcb_get_property(Connection, 1, Window, Property, XCB_ATOM_ANY, 0, UINT32_MAX / 4);
+		xcb_get_property_reply_t* Reply = xcb_get_property_reply(Connection, Cookie, nullptr);
+		const long Length = Reply != nullptr ? xcb_get_property_value_length(Reply) : -1;
+		std::free(Reply);
+		return Length;
+	}
+	return -1;
+}
+
+double MicrosecondsSince(const Clock::time_point Start)
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - Start).count();
+}
+
+std::string ToJson(const std::vector<Result>& Results, const std::string& Display)
+{
+	auto Percentile = [](const std::vector<double>& Sorted, const double P)
+	{
+		return Sorted[static_cast<size_t>(P * static_cast<double>(Sorted.size() - 1) + 0.5)];
+	};
+
+	std::ostringstream Json;
+	Json << "{\n  \"display\": \"" << Display << "\",\n  \"unit\": \"us\",\n  \"results\": [";
+	for (size_t i = 0; i < Results.size(); i++)
+	{
+		const Result& Entry = Results[i];
+		std::vector<double> Sorted = Entry.Samples;
+		std::ranges::sort(Sorted);
+
+		Json << (i > 0 ? "," : "") << "\n    { \"name\": \"" << Entry.Name << "\", \"samples\": " << Sorted.size()
+			<< ", \"failures\": " << Entry.Failures << ", \"skipped\": " << (Entry.Skipped ? "true" : "false");
+		if (Entry.Bytes > 0) Json << ", \"bytes\": " << Entry.Bytes;
+		if (!Sorted.empty())
+		{
+			double Sum = 0;
+			for (const double Sample : Sorted) Sum += Sample;
+			const double Mean = Sum / static_cast<double>(Sorted.size());
+
+			Json << ", \"min\": " << Sorted.front() << ", \"p50\": " << Percentile(Sorted, 0.5)
+				<< ", \"p90\": " << Percentile(Sorted, 0.9) << ", \"p99\": " << Percentile(Sorted, 0.99)
+				<< ", \"max\": " << Sorted.back() << ", \"mean\": " << Mean;
+			if (Entry.Bytes > 0)
+				Json << ", \"mb_per_s\": " << static_cast<double>(Entry.Bytes) / Percentile(Sorted, 0.5);
+		}
+		Json << " }";
+	}
+	Json << "\n  ]\n}";
+	return Json.str();
+}
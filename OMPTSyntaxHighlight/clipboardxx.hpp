@@ -11,6 +11,8 @@
     #error "platform not supported"
 #endif
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 
@@ -30,6 +32,10 @@ public:
 
     void copy(const std::string &text) const { m_clipboard->copy(text); }
 
+    void operator<<(ClipboardContent content) const { copy(std::move(content)); }
+
+    void copy(ClipboardContent content) const { m_clipboard->copy(std::move(content)); }
+
     void operator>>(std::string &result) const { result = paste(); }
 
     std::string paste() const { return m_clipboard->paste(); }
@@ -38,4 +44,56 @@ private:
     std::unique_ptr<ClipboardInterface> m_clipboard;
 };
 
+constexpr std::chrono::duration kDetachedOwnerTimeout = std::chrono::hours(1);
+
+// Copies so that the content can still be pasted after this process exits, and returns right away.
+// On Linux a forked background process owns the clipboard until another client takes it or the timeout expires;
+// the Windows clipboard keeps the data on its own.
+inline void copy_detached(ClipboardContent content, std::chrono::milliseconds timeout = kDetachedOwnerTimeout) {
+#ifdef WINDOWS
+    (void)timeout;
+    ClipboardWindows().copy(std::move(content));
+#elif defined(LINUX)
+    try {
+        copy_with_detached_owner(std::move(content), timeout);
+    } catch (const exception &error) {
+        throw exception("XCB Error: " + std::string(error.what()));
+    }
+#endif
+}
+
+// Pastes on a background thread, so waiting for the owner of the clipboard overlaps with the caller's own work
+inline std::future<std::string> paste_async() {
+    return std::async(std::launch::async, [] { return clipboard().paste(); });
+}
+
+// Starts connecting to the X server as soon as it is constructed, so the connection, window and atoms are set up
+// while the caller reads and renders its data. copy_detached then only waits for whatever setup is left and hands
+// the ready connection to the background owner.
+class async_clipboard {
+public:
+    async_clipboard() {
+#ifdef LINUX
+        m_session = std::async(std::launch::async, [] { return X11Session(); });
+#endif
+    }
+
+    void copy_detached(ClipboardContent content, std::chrono::milliseconds timeout = kDetachedOwnerTimeout) {
+#ifdef LINUX
+        try {
+            copy_with_detached_owner(std::move(content), timeout, m_session.get());
+        } catch (const exception &error) {
+            throw exception("XCB Error: " + std::string(error.what()));
+        }
+#else
+        clipboardxx::copy_detached(std::move(content), timeout);
+#endif
+    }
+
+private:
+#ifdef LINUX
+    std::future<X11Session> m_session;
+#endif
+};
+
 } // namespace clipboardxx
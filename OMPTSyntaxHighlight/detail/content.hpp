@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clipboardxx {
+
+// A set of representations of the same clipboard data. Representation 0 is the plain text one and is offered under
+// every supported text format, the others are offered under their own target name. Each representation is rendered
+// the first time it is requested and memoized afterwards.
+class ClipboardContent {
+public:
+    using Renderer = std::function<std::string()>;
+
+    ClipboardContent(const std::string &text) { m_representations.push_back({"", nullptr, text}); }
+
+    ClipboardContent(Renderer text_renderer) { add_target("", std::move(text_renderer)); }
+
+    void add_target(const std::string &target, Renderer renderer) {
+        m_representations.push_back({target, std::move(renderer), std::nullopt});
+    }
+
+    size_t size() const { return m_representations.size(); }
+
+    const std::string &target(size_t index) const { return m_representations.at(index).target; }
+
+    const std::string &render(size_t index) {
+        Representation &representation = m_representations.at(index);
+        if (!representation.rendered.has_value()) {
+            representation.rendered = representation.renderer();
+            representation.renderer = nullptr;
+        }
+        return representation.rendered.value();
+    }
+
+    const std::string &text() { return render(0); }
+
+private:
+    struct Representation {
+        std::string target;
+        Renderer renderer;
+        std::optional<std::string> rendered;
+    };
+
+    std::vector<Representation> m_representations;
+};
+
+} // namespace clipboardxx
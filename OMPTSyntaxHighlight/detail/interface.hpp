@@ -1,5 +1,7 @@
 #pragma once
 
+#include "content.hpp"
+
 #include <string>
 
 namespace clipboardxx {
@@ -8,6 +10,7 @@ class ClipboardInterface {
 public:
     virtual ~ClipboardInterface() = default;
     virtual void copy(const std::string &text) const = 0;
+    virtual void copy(ClipboardContent content) const = 0;
     virtual std::string paste() const = 0;
 };
 
@@ -3,6 +3,7 @@
 #ifdef LINUX
     #include "exception.hpp"
     #include "interface.hpp"
+    #include "linux/x11_detached_owner.hpp"
     #include "linux/x11_provider.hpp"
 
 namespace clipboardxx {
@@ -11,9 +12,11 @@ class ClipboardLinux : public ClipboardInterface {
 public:
     ClipboardLinux() : m_provider(std::make_unique<X11Provider>()) {}
 
-    void copy(const std::string &text) const override {
+    void copy(const std::string &text) const override { copy(ClipboardContent(text)); }
+
+    void copy(ClipboardContent content) const override {
         try {
-            m_provider->copy(text);
+            m_provider->copy(std::move(content));
         } catch (const exception &error) {
             throw exception("XCB Error: " + std::string(error.what()));
         }
@@ -1,12 +1,14 @@
 #pragma once
 
+#include "../content.hpp"
+
 #include <string>
 
 namespace clipboardxx {
 
 class LinuxClipboardProvider {
 public:
-    virtual void copy(const std::string &text) = 0;
+    virtual void copy(ClipboardContent content) = 0;
     virtual std::string paste() = 0;
     virtual ~LinuxClipboardProvider() = default;
 };
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "../content.hpp"
+#include "../exception.hpp"
+#include "x11_event_handler.hpp"
+#include "xcb/xcb.hpp"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace clipboardxx {
+
+constexpr std::chrono::duration kDetachedOwnerStartTimeout = std::chrono::seconds(5);
+constexpr std::string_view kDetachedOwnerReady = "ready";
+
+// An open connection with its window and atoms, the part of copying that only depends on the X server
+struct X11Session {
+    X11Session() : xcb(std::make_unique<xcb::Xcb>()), atoms(create_essential_atoms(*xcb)) {}
+
+    std::unique_ptr<xcb::Xcb> xcb;
+    EssentialAtoms atoms;
+};
+
+// Selection owner running in a background process on its own connection. Single threaded: it sleeps on the
+// connection until an event arrives and stops as soon as another client takes the clipboard or the timeout expires.
+class X11DetachedOwner {
+public:
+    X11DetachedOwner(X11Session session, ClipboardContent content)
+        : m_xcb(std::move(session.xcb)), m_atoms(std::move(session.atoms)),
+          m_selection(*m_xcb, m_atoms, std::move(content)) {}
+
+    void take_ownership() { m_xcb->become_selection_owner(m_atoms.clipboard); }
+
+    void serve(std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (!m_xcb->has_connection_error()) {
+            while (std::optional<std::unique_ptr<xcb::Event>> event = m_xcb->get_latest_event()) {
+                if (!handle_event(event->get()))
+                    return;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+                return;
+            m_xcb->wait_for_event(std::chrono::ceil<std::chrono::milliseconds>(deadline - now));
+        }
+    }
+
+private:
+    // returns false once we no longer own the clipboard
+    bool handle_event(const xcb::Event* event) {
+        switch (event->get_type()) {
+        case xcb::Event::Type::kRequestSelection: {
+            const auto* request = static_cast<const xcb::RequestSelectionEvent*>(event);
+            if (request->m_selection == m_atoms.clipboard)
+                m_selection.serve(*m_xcb, m_atoms, request);
+            return true;
+        }
+        case xcb::Event::Type::kSelectionClear:
+            return static_cast<const xcb::SelectionClearEvent*>(event)->m_selection != m_atoms.clipboard;
+        default:
+            return true;
+        }
+    }
+
+    const std::unique_ptr<xcb::Xcb> m_xcb;
+    const EssentialAtoms m_atoms;
+    // Representations rendered before the fork are the parent's strings, shared copy-on-write, and are written to the
+    // requestors from there; the others are rendered here on first request and memoized the same way
+    SelectionServer m_selection;
+};
+
+inline void write_owner_status(int fd, std::string_view status) {
+    while (!status.empty()) {
+        ssize_t written = write(fd, status.data(), status.size());
+        if (written <= 0)
+            return;
+        status.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+[[noreturn]] inline void run_detached_owner(std::optional<X11Session> session, ClipboardContent content,
+                                            std::chrono::milliseconds timeout, int status_fd) noexcept {
+    try {
+        X11DetachedOwner owner(session.has_value() ? std::move(session.value()) : X11Session(), std::move(content));
+        owner.take_ownership();
+
+        write_owner_status(status_fd, kDetachedOwnerReady);
+        close(status_fd);
+        status_fd = -1;
+
+        owner.serve(timeout);
+    } catch (const std::exception &error) {
+        if (status_fd >= 0)
+            write_owner_status(status_fd, error.what());
+    }
+    _exit(0);
+}
+
+// Hands the content to a forked background process that owns the clipboard until another client takes it or the
+// timeout expires, so it can still be pasted after we exit. Returns once the background process owns the clipboard.
+// The owner opens its own connection unless one that is already set up is given, which it then takes over.
+// Must be called while no other thread is running, as it forks.
+inline void copy_with_detached_owner(ClipboardContent content, std::chrono::milliseconds timeout,
+                                     std::optional<X11Session> session = std::nullopt) {
+    int status_pipe[2];
+    if (pipe(status_pipe) != 0)
+        throw exception("Cannot create pipe for the clipboard owner");
+
+    pid_t child = fork();
+    if (child < 0) {
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        throw exception("Cannot start the clipboard owner");
+    }
+
+    if (child == 0) {
+        // double fork in a new session, so the owner is reparented to init and never left as a zombie
+        close(status_pipe[0]);
+        setsid();
+        if (fork() != 0)
+            _exit(0);
+
+        // do not keep the caller's terminal or output pipes open
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            if (null_fd > STDERR_FILENO)
+                close(null_fd);
+        }
+        run_detached_owner(std::move(session), std::move(content), timeout, status_pipe[1]);
+    }
+
+    // the connection now belongs to the owner, disconnecting would shut its socket down for the owner too
+    if (session.has_value())
+        static_cast<void>(session->xcb.release());
+
+    close(status_pipe[1]);
+    waitpid(child, nullptr, 0);
+
+    std::string status;
+    const auto deadline = std::chrono::steady_clock::now() + kDetachedOwnerStartTimeout;
+    while (status != kDetachedOwnerReady) {
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd descriptor{.fd = status_pipe[0], .events = POLLIN, .revents = 0};
+        if (remaining.count() <= 0 || poll(&descriptor, 1, static_cast<int>(remaining.count())) <= 0)
+            break;
+
+        char buffer[256];
+        ssize_t received = read(status_pipe[0], buffer, sizeof(buffer));
+        if (received <= 0)
+            break;
+        status.append(buffer, static_cast<size_t>(received));
+    }
+    close(status_pipe[0]);
+
+    if (status != kDetachedOwnerReady)
+        throw exception(status.empty() ? "Clipboard owner did not start" : status);
+}
+
+} // namespace clipboardxx
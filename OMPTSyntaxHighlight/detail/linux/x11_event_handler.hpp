@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../content.hpp"
 #include "xcb/xcb.hpp"
 
 #include <algorithm>
@@ -25,12 +26,76 @@ struct EssentialAtoms {
     xcb::Atom clipboard, targets, atom, buffer;
 };
 
+inline EssentialAtoms create_essential_atoms(xcb::Xcb &xcb) {
+    EssentialAtoms atoms;
+    atoms.clipboard = xcb.create_atom("CLIPBOARD");
+    atoms.buffer = xcb.create_atom("BUFFER");
+    atoms.targets = xcb.create_atom("TARGETS");
+    atoms.atom = xcb.create_atom("ATOM");
+
+    atoms.supported_text_formats = std::vector<xcb_atom_t>(kSupportedTextFormats.size());
+    std::transform(kSupportedTextFormats.begin(), kSupportedTextFormats.end(), atoms.supported_text_formats.begin(),
+                   [&xcb](const char* name) { return xcb.create_atom(std::string(name)); });
+    return atoms;
+}
+
+inline std::vector<xcb::Atom> generate_targets_atom_array(xcb::Atom target, const std::vector<xcb::Atom> &atoms) {
+    std::vector<xcb::Atom> targets(atoms.size() + 1);
+    targets[0] = target;
+    std::copy(atoms.begin(), atoms.end(), targets.begin() + 1);
+    return targets;
+}
+
+// Serves the clipboard selection from a ClipboardContent, for both the in-process and the detached owner: TARGETS
+// lists every target, the supported text formats get representation 0 and the other representations their own target.
+// The target atoms are interned on construction, so this must be created before taking ownership.
+class SelectionServer {
+public:
+    SelectionServer(xcb::Xcb &xcb, const EssentialAtoms &atoms, ClipboardContent content)
+        : m_content(std::move(content)),
+          m_targets(generate_targets_atom_array(atoms.targets, atoms.supported_text_formats)),
+          m_extra_targets(m_content.size()) {
+        for (size_t i = 1; i < m_content.size(); i++) {
+            m_extra_targets[i] = xcb.create_atom(m_content.target(i));
+            m_targets.push_back(m_extra_targets[i]);
+        }
+    }
+
+    ClipboardContent &content() { return m_content; }
+
+    // representations are rendered on first request only, then served from the memoized copy
+    void serve(xcb::Xcb &xcb, const EssentialAtoms &atoms, const xcb::RequestSelectionEvent* event) {
+        bool found_format = std::find(atoms.supported_text_formats.begin(), atoms.supported_text_formats.end(),
+                                      event->m_target) != atoms.supported_text_formats.end();
+        auto extra_target = std::find(m_extra_targets.begin() + 1, m_extra_targets.end(), event->m_target);
+        if (event->m_target == atoms.targets) {
+            xcb.write_on_window_property(event->m_requestor, event->m_property, atoms.atom, m_targets);
+            xcb.notify_window_property_change(event->m_requestor, event->m_property, atoms.atom, event->m_selection);
+        } else if (found_format || extra_target != m_extra_targets.end()) {
+            size_t index = found_format ? 0 : static_cast<size_t>(extra_target - m_extra_targets.begin());
+            xcb.write_on_window_property(event->m_requestor, event->m_property, event->m_target,
+                                         m_content.render(index));
+            xcb.notify_window_property_change(event->m_requestor, event->m_property, event->m_target,
+                                              event->m_selection);
+        } else {
+            refuse(xcb, event);
+        }
+    }
+
+    // the requestor waits for an answer, so a request that cannot be served is refused instead of ignored
+    static void refuse(xcb::Xcb &xcb, const xcb::RequestSelectionEvent* event) {
+        xcb.notify_window_property_change(event->m_requestor, 0, event->m_target, event->m_selection);
+    }
+
+private:
+    ClipboardContent m_content;
+    std::vector<xcb::Atom> m_targets, m_extra_targets;
+};
+
 class X11EventHandler {
 public:
     X11EventHandler(std::shared_ptr<xcb::Xcb> xcb)
-        : m_xcb(std::move(xcb)), m_atoms(create_essential_atoms()),
-          m_targets(generate_targets_atom_array(m_atoms.targets, m_atoms.supported_text_formats)),
-          m_stop_event_thread(false) {
+        : m_xcb(std::move(xcb)), m_atoms(create_essential_atoms(*m_xcb)), m_stop_event_thread(false) {
         m_event_thread = std::thread(&X11EventHandler::handle_events_for_ever, this);
     }
 
@@ -39,16 +104,21 @@ public:
         m_event_thread.join();
     }
 
-    void set_copy_data(const std::string &data) {
+    // Stores the data and takes the clipboard. The target atoms are interned before, and ownership is taken while the
+    // event thread is locked out, so every selection request that follows finds the data ready.
+    void set_copy_data(ClipboardContent data) {
+        SelectionServer selection(*m_xcb, m_atoms, std::move(data));
+
         std::lock_guard<std::mutex> lock_guard(m_lock);
-        m_copy_data = std::optional<std::string>(data);
+        m_selection.emplace(std::move(selection));
+        m_xcb->become_selection_owner(m_atoms.clipboard);
     }
 
     std::string get_paste_data() {
         {
             std::lock_guard<std::mutex> lock_guard(m_lock);
             if (do_we_own_clipoard())
-                return m_copy_data.value();
+                return m_selection->content().text();
             else
                 m_xcb->request_selection_data(m_atoms.clipboard, m_atoms.supported_text_formats.at(0), m_atoms.buffer);
         }
@@ -61,27 +131,7 @@ public:
     }
 
 private:
-    EssentialAtoms create_essential_atoms() const {
-        EssentialAtoms atoms;
-        atoms.clipboard = m_xcb->create_atom("CLIPBOARD");
-        atoms.buffer = m_xcb->create_atom("BUFFER");
-        atoms.targets = m_xcb->create_atom("TARGETS");
-        atoms.atom = m_xcb->create_atom("ATOM");
-
-        atoms.supported_text_formats = std::vector<xcb_atom_t>(kSupportedTextFormats.size());
-        std::transform(kSupportedTextFormats.begin(), kSupportedTextFormats.end(), atoms.supported_text_formats.begin(),
-                       [this](const char* name) { return m_xcb->create_atom(std::string(name)); });
-        return atoms;
-    }
-
-    std::vector<xcb::Atom> generate_targets_atom_array(xcb::Atom target, const std::vector<xcb::Atom> &atoms) {
-        std::vector<xcb::Atom> targets(atoms.size() + 1);
-        targets[0] = target;
-        std::copy(atoms.begin(), atoms.end(), targets.begin() + 1);
-        return targets;
-    }
-
-    bool do_we_own_clipoard() const { return m_copy_data.has_value(); }
+    bool do_we_own_clipoard() const { return m_selection.has_value(); }
 
     void wait_for_paste_data_with_timeout(std::chrono::milliseconds timeout) {
         m_paste_data.reset();
@@ -119,7 +169,7 @@ private:
             handle_request_selection_event(reinterpret_cast<xcb::RequestSelectionEvent*>(event.get()));
             break;
         case xcb::Event::Type::kSelectionClear:
-            m_copy_data = std::nullopt;
+            m_selection.reset();
             break;
         case xcb::Event::Type::kSelectionNotify:
             handle_selection_notify_event(reinterpret_cast<xcb::SelectionNotifyEvent*>(event.get()));
@@ -130,23 +180,13 @@ private:
     }
 
     void handle_request_selection_event(const xcb::RequestSelectionEvent* event) {
-        if (event->m_selection != m_atoms.clipboard || !m_copy_data.has_value())
+        if (event->m_selection != m_atoms.clipboard)
             return;
 
-        bool found_format = std::find(m_atoms.supported_text_formats.begin(), m_atoms.supported_text_formats.end(),
-                                      event->m_target) != m_atoms.supported_text_formats.end();
-        if (event->m_target == m_atoms.targets) {
-            m_xcb->write_on_window_property(event->m_requestor, event->m_property, m_atoms.atom, m_targets);
-            m_xcb->notify_window_property_change(event->m_requestor, event->m_property, m_atoms.atom,
-                                                 event->m_selection);
-        } else if (found_format) {
-            m_xcb->write_on_window_property(event->m_requestor, event->m_property, event->m_target,
-                                            m_copy_data.value());
-            m_xcb->notify_window_property_change(event->m_requestor, event->m_property, event->m_target,
-                                                 event->m_selection);
-        } else {
-            m_xcb->notify_window_property_change(event->m_requestor, 0, event->m_target, event->m_selection);
-        }
+        if (m_selection.has_value())
+            m_selection->serve(*m_xcb, m_atoms, event);
+        else
+            SelectionServer::refuse(*m_xcb, event);
     }
 
     void handle_selection_notify_event(const xcb::SelectionNotifyEvent* event) {
@@ -157,8 +197,8 @@ private:
 
     const std::shared_ptr<xcb::Xcb> m_xcb;
     const EssentialAtoms m_atoms;
-    const std::vector<xcb_atom_t> m_targets;
-    std::optional<std::string> m_copy_data, m_paste_data;
+    std::optional<SelectionServer> m_selection;
+    std::optional<std::string> m_paste_data;
     std::mutex m_lock;
     std::thread m_event_thread;
     std::atomic<bool> m_stop_event_thread;
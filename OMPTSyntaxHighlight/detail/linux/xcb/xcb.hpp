@@ -4,8 +4,10 @@
 #include "xcb_event.hpp"
 
 #include <assert.h>
+#include <chrono>
 #include <memory>
 #include <optional>
+#include <poll.h>
 #include <xcb/xcb.h>
 
 namespace clipboardxx {
@@ -54,6 +56,14 @@ public:
         return convert_generic_event_to_event(std::move(event));
     }
 
+    // blocks until the connection has something to read or the timeout expires, returns false on timeout
+    bool wait_for_event(std::chrono::milliseconds timeout) const {
+        pollfd descriptor{.fd = xcb_get_file_descriptor(m_conn.get()), .events = POLLIN, .revents = 0};
+        return poll(&descriptor, 1, static_cast<int>(timeout.count())) > 0;
+    }
+
+    bool has_connection_error() const { return xcb_connection_has_error(m_conn.get()) > 0; }
+
     template <typename Container, typename ValueType = typename Container::value_type>
     void write_on_window_property(Window window, Atom property, Atom target, const Container &data) {
         xcb_change_property(m_conn.get(), XCB_PROP_MODE_REPLACE, window, property, target,
@@ -22,6 +22,9 @@ public:
         set_clipboard_data_from_memory(buffer.get());
     }
 
+    // only the plain text representation is published, the others are not rendered at all
+    void copy(ClipboardContent content) const override { copy(content.text()); }
+
     std::string paste() const noexcept override {
         OpenCloseClipboardRaii clipboard_raii;
         return get_clipboard_data();
@@ -0,0 +1,92 @@
+// Wrap-around test of the shared memory ring buffer, on a small ring so records reach the end of the buffer quickly.
+// Exits with 1 and lists the failed checks on STDERR if anything is off.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "ShmRing.hpp"
+
+constexpr size_t RING_CAPACITY = 1024;
+constexpr std::chrono::milliseconds NO_WAIT(0);
+constexpr std::chrono::milliseconds WAIT(1000);
+
+int Failures = 0;
+
+void Check(const bool Condition, const std::string_view What)
+{
+	if (Condition) return;
+	std::cerr << "FAILED: " << What << std::endl;
+	Failures++;
+}
+
+// Reads and releases one record, empty if there is none
+std::string ReadRecord(ShmRingConsumer& Consumer, const std::chrono::milliseconds Timeout = NO_WAIT)
+{
+	const std::optional<std::string_view> Record = Consumer.Read(Timeout);
+	if (!Record.has_value()) return {};
+
+	std::string Text(*Record);
+	Consumer.Release();
+	return Text;
+}
+
+int main()
+{
+	const std::string Name = "/omptsh-test-" + std::to_string(getpid());
+	ShmRing::Unlink(Name);
+
+	try
+	{
+		ShmRingConsumer Consumer(Name, RING_CAPACITY);
+
+		{
+			ShmRingProducer Producer(Name, RING_CAPACITY);
+			const std::string First(500, 'a');
+			Check(Producer.Write(First, NO_WAIT), "record fits into the empty ring");
+			Check(ReadRecord(Consumer) == First, "record reads back");
+
+			// Does not fit between offset 512 and the end, so the end is published as padding and the record waits for the
+			// consumer to skip it, as a consumer reading along does
+			const std::string Wrapped(600, 'b');
+			std::string Received;
+			std::thread Reader([&] { Received = ReadRecord(Consumer, WAIT); });
+			Check(Producer.Write(Wrapped, WAIT), "record wraps to the start of the empty ring");
+			Reader.join();
+			Check(Received == Wrapped, "wrapped record reads back after the padding");
+			Check(!Consumer.Read(NO_WAIT).has_value(), "ring is empty after reading everything");
+		}
+
+		// The positions live in the segment, a later producer continues where the last one stopped
+		{
+			ShmRingProducer Producer(Name, RING_CAPACITY);
+			const std::string Record(300, 'c');
+			Check(Producer.Write(Record, NO_WAIT), "second producer writes after the wrap");
+			Check(Producer.Write(Record, NO_WAIT), "second record fits behind the first");
+			Check(!Producer.Write(Record, NO_WAIT), "third record does not fit while the others are unread");
+			Check(ReadRecord(Consumer) == Record && ReadRecord(Consumer) == Record, "both records read back in order");
+
+			bool Thrown = false;
+			try
+			{
+				Producer.Write(std::string(RING_CAPACITY, 'd'), NO_WAIT);
+			}
+			catch (const ShmRingError&)
+			{
+				Thrown = true;
+			}
+			Check(Thrown, "record larger than the ring is an error, not a full ring");
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "FAILED: " << e.what() << std::endl;
+		Failures++;
+	}
+
+	ShmRing::Unlink(Name);
+	return Failures == 0 ? 0 : 1;
+}